@@ -7,14 +7,17 @@
 #include "window.h"
 #include "ft2font.h"
 #include "shader.h"
+#include "guibatch.h"
 
 /**
 * \brief The base class for all used gui-elements.
 *
 * Holds all methods and variables, that are needed by the sub classes.
-* A block is always in a shape of a rectangle. A Vertex buffer object 
-* is used to store it's geometry data. There is one "Gui" - Shader program
-* defined as a global in the "block.cpp" file to paint the blocks.
+* A block is always in a shape of a rectangle. Blocks are not drawn one by one,
+* their "update()" methods add a quad to the gui batch, which draws all blocks
+* of a frame at once. The batch and the "Gui" - Shader program are defined as
+* globals in the "block.cpp" file. Changing the color, the position or the text
+* of a block invalidates the batch, so that the blocks are collected again.
 */
 class Block {
 public:
@@ -61,7 +64,7 @@ public:
 	void reorder(int posX, int posY);
 
 	/**
-	* \brief Creates a text in form of a texture, that will be displayed in the center
+	* \brief Lays out a text with the glyphs of the font, that will be displayed in the center
 	* of the block. Can be overloaded in sub classes.
 	*
 	* \param[in] str String that will be displayed in the block.
@@ -71,8 +74,8 @@ public:
 	virtual void text(wstring str, Font& f);
 
 	/**
-	* \brief The update function, which draws the block on the current context.
-	* Needs to be overloaded by subclasses.
+	* \brief The update function, which adds the block to the gui batch. The batch
+	* needs to be drawn afterwards. Needs to be overloaded by subclasses.
 	*/
 	virtual void update() = 0;
 
@@ -103,10 +106,29 @@ public:
 
 protected:
 	/**
-	* \brief Calculates the vertices and transforms them into OpenGL coordinates.
+	* \brief Calculates the corners of the block and of its glyphs and transforms them into OpenGL coordinates.
 	*/
 	void calculateVertices();
 
+	/**
+	* \brief Adds the quad of the block and the quads of its glyphs to the gui batch. Calculates the
+	* corners again when the window was resized.
+	*
+	* \param[in] brightness Factor for the color of the block and its text.
+	*/
+	void draw(float brightness);
+
+	/**
+	* \brief Replaces the glyphs of the block with the glyphs of the given text.
+	*
+	* \param[in] text The laid out text.
+	*
+	* \param[in] xOff Distance from the left edge of the block to the text in pixels.
+	*
+	* \param[in] yOff Distance from the bottom edge of the block to the text in pixels.
+	*/
+	void placeText(Text &text, int xOff, int yOff);
+
 	/**
 	* \brief Top left corner position on x-axis.
 	*/
@@ -138,14 +160,25 @@ protected:
 	float m_rgba[4];
 
 	/**
-	* \brief Vertex buffer object for the block.
+	* \brief Top left and bottom right corner of the block in OpenGL coordinates.
+	*/
+	vec2 m_corners[2];
+
+	/**
+	* \brief Left, top, right and bottom edge of every glyph of the text in pixels, relative to the
+	* top left corner of the block.
+	*/
+	vector<vec4> m_glyphRects;
+
+	/**
+	* \brief Texture coordinates of every glyph of the text in the gui atlas.
 	*/
-	Buffer<vec2>* m_vbuf;
+	vector<vec4> m_glyphTexCoords;
 
 	/**
-	* \brief Texture for the block.
+	* \brief Top left and bottom right corner of every glyph in OpenGL coordinates.
 	*/
-	Texture* m_tex;
+	vector<vec2> m_glyphCorners;
 
 	/**
 	* \brief String for the text.
@@ -159,18 +192,8 @@ protected:
 const Shader* getGuiShader();
 
 /**
-* \brief Getter for the 'useTexture' uniform location id that was set once in the block.cpp file
-*/
-const GLuint getUseTexLoc();
-
-/**
-* \brief Getter for the 'color' uniform location id that was set once in the block.cpp file
-*/
-const GLuint getColorLoc();
-
-/**
-* \brief Getter for the 'brightness' uniform location id that was set once in the block.cpp file
+* \brief Getter for the gui batch, which draws all blocks.
 */
-const GLuint getBrightnessLoc();
+GuiBatch* getGuiBatch();
 
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "error.h"
+#include "glstate.h"
 #include <GL/glew.h>
 #include <vector>
 
@@ -21,7 +22,7 @@ public:
 	* \param[in] usage defines how the buffer data shall be used.
 	*/
 	Buffer(GLuint size, GLenum usage)
-		:m_stride(sizeof(T)), m_vertexCount(size), m_eboActive(false)
+		:m_stride(sizeof(T)), m_vertexCount(size), m_elementCount(0), m_streamId(0), m_eboActive(false)
 	{
 		if (size == 0)
 			printCriticalError("Buffer(size, vertexSize, usage)", "Size equals zero.");
@@ -33,13 +34,13 @@ public:
 			glGenVertexArrays(1, &m_vaoId);
 
 			// Bind vertex array object
-			glBindVertexArray(m_vaoId);
+			GLState::bindVertexArray(m_vaoId);
 
 			// Generate buffer object name and store it in member variable
 			glGenBuffers(1, &m_vboId);
 
 			// Bind Buffer to the GL_ARRAY_BUFFER target
-			glBindBuffer(GL_ARRAY_BUFFER, m_vboId);
+			GLState::bindBuffer(GL_ARRAY_BUFFER, m_vboId);
 
 			// Upload buffer data
 			glBufferData(GL_ARRAY_BUFFER, size*m_stride, nullptr, usage);
@@ -57,7 +58,7 @@ public:
 	* \param[in] usage defines how the buffer data shall be used
 	*/
 	Buffer(const vector<T>& vertices, GLenum usage)
-		:m_stride(sizeof(T)), m_vertexCount(vertices.size()), m_eboActive(false)
+		:m_stride(sizeof(T)), m_vertexCount(vertices.size()), m_elementCount(0), m_streamId(0), m_eboActive(false)
 	{
 		if (vertices.empty())
 			printCriticalError("Buffer(vertices, vertexSize, usage)", "Vertex list is empty");
@@ -67,10 +68,10 @@ public:
 
 			// See comments in the first constructor as reference for this code block
 			glGenVertexArrays(1, &m_vaoId);
-			glBindVertexArray(m_vaoId);
+			GLState::bindVertexArray(m_vaoId);
 
 			glGenBuffers(1, &m_vboId);
-			glBindBuffer(GL_ARRAY_BUFFER, m_vboId);
+			GLState::bindBuffer(GL_ARRAY_BUFFER, m_vboId);
 			glBufferData(GL_ARRAY_BUFFER, vertices.size()*m_stride, vertices.data(), usage);
 			checkGLError("Buffer(vertices, vertexSize, usage) -> Creating VBO " + to_string(m_vboId));
 		}
@@ -87,7 +88,7 @@ public:
 	* \param[in] usage defines how the buffer data shall be used
 	*/
 	Buffer(const vector<T>& vertices, const vector<GLuint>& elements, GLenum usage)
-		:m_stride(sizeof(T)), m_vertexCount(vertices.size()), m_eboActive(true)
+		:m_stride(sizeof(T)), m_vertexCount(vertices.size()), m_elementCount(elements.size()), m_streamId(0), m_eboActive(true)
 	{
 		if (vertices.empty())
 			printCriticalError("Buffer(vertices, elements, vertexSize, usage)", "Vertex list is empty");
@@ -99,16 +100,16 @@ public:
 
 			// See comments in the first constructor as reference for this code block
 			glGenVertexArrays(1, &m_vaoId);
-			glBindVertexArray(m_vaoId);
+			GLState::bindVertexArray(m_vaoId);
 
 			glGenBuffers(1, &m_vboId);
-			glBindBuffer(GL_ARRAY_BUFFER, m_vboId);
+			GLState::bindBuffer(GL_ARRAY_BUFFER, m_vboId);
 			glBufferData(GL_ARRAY_BUFFER, vertices.size()*m_stride, vertices.data(), usage);
 			checkGLError("Buffer(vertices, elements, vertexSize, usage) -> Creating VBO " + to_string(m_vboId));
 
 			// Same procedure with the element buffer object
 			glGenBuffers(1, &m_eboId);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_eboId);
+			GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_eboId);
 			glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements.size()*sizeof(GLuint), elements.data(), usage);
 			checkGLError("Buffer(vertices, elements, vertexSize, usage) -> Creating EBO " + to_string(m_eboId));
 			m_eboActive = true;
@@ -158,10 +159,68 @@ public:
 			// Vertex attribute array need to be enabled
 			glEnableVertexAttribArray(att);
 
+			// Remember the attribute so that it can be set again when the buffer objects are exchanged
+			m_attribs.push_back({ att, attElementCount, GL_FLOAT, GL_FALSE, GLsizei(stride_tmp), GLintptr(offset*sizeof(GLfloat)) });
+
 			checkGLError("Buffer::attrib(..) VBO Id " + to_string(m_vboId));
 		}
 	}
 
+	/**
+	* \brief Adds an attribute that is read from a second, separate vertex buffer object (the stream)
+	* instead of the buffer of type T. This is used for data that changes more often than the rest of
+	* the vertex, so that only the stream needs to be uploaded again. The attribute is tightly packed
+	* and is set as soon as a stream buffer object is given to "adoptStream()". Until then the
+	* attribute is disabled and reads a constant 0.
+	*
+	* \param[in] shaderId id of the shader the attribute is uploaded to.
+	*
+	* \param[in] name Name of the attribute in the given shader.
+	*
+	* \param[in] attElementCount Number of components of the attribute.
+	*
+	* \param[in] type Type of one component, e.g. GL_FLOAT or GL_UNSIGNED_SHORT.
+	*
+	* \param[in] normalized Whether integer components are mapped to [0.0, 1.0] or [-1.0, 1.0].
+	*/
+	void streamAttrib(GLuint shaderId, const GLchar* name, GLint attElementCount, GLenum type, GLboolean normalized) {
+		if (name == nullptr || name[0] == '\0')
+			printError("Buffer::streamAttrib(..) VBO Id " + to_string(m_vboId), "Given parameter 'name' is null or empty. No attribute is being set.");
+		else {
+			checkGLError("Buffer::streamAttrib(..) -> Error occurred before this call");
+
+			GLint att = glGetAttribLocation(shaderId, name);
+			m_streamAttribs.push_back({ att, attElementCount, type, normalized, 0, 0 });
+
+			// Set the attribute right away if there is already a stream
+			if (m_streamId != 0)
+				adoptStream(m_streamId);
+		}
+	}
+
+	/**
+	* \brief Replaces the stream buffer object with the given one, which was created with "createStorage()",
+	* and sets all attributes added with "streamAttrib()" for it. The old stream buffer object is deleted.
+	*
+	* \param[in] streamId The new stream buffer object.
+	*/
+	void adoptStream(GLuint streamId) {
+		checkGLError("Buffer::adoptStream(..) VBO Id " + to_string(m_vboId) + " -> Error occurred before this call");
+
+		GLState::bindVertexArray(m_vaoId);
+		if (m_streamId != 0 && m_streamId != streamId)
+			GLState::deleteBuffers(1, &m_streamId);
+		m_streamId = streamId;
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, m_streamId);
+		for (const Attrib &a : m_streamAttribs) {
+			glVertexAttribPointer(a.location, a.elementCount, a.type, a.normalized, a.stride, (const void*)a.offset);
+			glEnableVertexAttribArray(a.location);
+		}
+		GLState::bindBuffer(GL_ARRAY_BUFFER, m_vboId);
+		checkGLError("Buffer::adoptStream(..) Stream Id " + to_string(m_streamId));
+	}
+
 	/**
 	* \brief Overwrites the current vertex buffer with the given vertices.
 	*
@@ -230,8 +289,9 @@ public:
 			// Set active buffer object
 			use();
 
-			// Set new vertex count because this function is called, when the vertex count differs
+			// Set new vertex and element count because this function is called, when the vertex count differs
 			m_vertexCount = vertices.size();
+			m_elementCount = elements.size();
 
 			// Call glBufferData again to create a buffer with a new size
 			glBufferData(GL_ARRAY_BUFFER, vertices.size()*m_stride, vertices.data(), usage);
@@ -244,13 +304,123 @@ public:
 	}
 
 	/**
-	* \brief Binds vertex or element buffer and uses them.
+	* \brief Creates a buffer object and fills it with the given data, without any vertex array object.
+	* Vertex array objects are not shared between OpenGL contexts, so this is used by the loader thread
+	* to prepare buffer objects that are handed over to "adopt()" on the render thread afterwards.
+	*
+	* \param[in] target Target the buffer object is created for. GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER.
+	*
+	* \param[in] size Size of the data in bytes.
+	*
+	* \param[in] data Pointer to the data that is uploaded.
+	*
+	* \param[in] usage defines how the buffer data shall be used.
+	*
+	* \return Id of the created buffer object.
+	*/
+	static GLuint createStorage(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+		checkGLError("Buffer::createStorage(..) -> Error occurred before this call");
+
+		GLuint id;
+		glGenBuffers(1, &id);
+		GLState::bindBuffer(target, id);
+		glBufferData(target, size, data, usage);
+		GLState::bindBuffer(target, 0);
+		checkGLError("Buffer::createStorage(..) -> Creating buffer object " + to_string(id));
+		return id;
+	}
+
+	/**
+	* \brief Maps the whole storage of a buffer object for writing, so that data can be generated
+	* directly into it without a copy. Used together with "createStorage()" and a null data pointer:
+	* the storage was just allocated and no draw call uses it yet, so it is neither orphaned again nor
+	* synchronized, and its content does not need to be preserved.
+	*
+	* \param[in] target Target the buffer object was created for.
+	*
+	* \param[in] id Id of the buffer object.
+	*
+	* \param[in] size Size of the storage in bytes.
+	*
+	* \return Pointer to the write only memory or null if mapping failed.
+	*/
+	static void* mapStorage(GLenum target, GLuint id, GLsizeiptr size) {
+		checkGLError("Buffer::mapStorage(..) -> Error occurred before this call");
+
+		GLState::bindBuffer(target, id);
+		void* ptr = glMapBufferRange(target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		checkGLError("Buffer::mapStorage(..) -> Mapping buffer object " + to_string(id));
+
+		if (!ptr)
+			printError("Buffer::mapStorage(..)", "Buffer object " + to_string(id) + " could not be mapped.");
+		return ptr;
+	}
+
+	/**
+	* \brief Unmaps a buffer object that was mapped with "mapStorage()".
+	*
+	* \param[in] target Target the buffer object was created for.
+	*
+	* \param[in] id Id of the buffer object.
+	*
+	* \return False if the content of the storage got lost while it was mapped (e.g. on a display
+	* mode change). Then it needs to be mapped and written again.
+	*/
+	static bool unmapStorage(GLenum target, GLuint id) {
+		GLState::bindBuffer(target, id);
+		GLboolean intact = glUnmapBuffer(target);
+		GLState::bindBuffer(target, 0);
+		checkGLError("Buffer::unmapStorage(..) -> Unmapping buffer object " + to_string(id));
+		return intact == GL_TRUE;
+	}
+
+	/**
+	* \brief Replaces the vertex and element buffer objects with the given ones, which were created
+	* with "createStorage()". The old buffer objects are deleted and all attributes, that were set with
+	* "attrib()", are set again for the new vertex buffer.
+	*
+	* \param[in] vboId The new vertex buffer object. If it is 0 the current vertex buffer is kept.
+	*
+	* \param[in] eboId The new element buffer object. If it is 0 the current element buffer is kept.
+	*
+	* \param[in] vertexCount Number of vertices in the new vertex buffer object. Ignored if vboId is 0.
+	*
+	* \param[in] elementCount Number of elements in the new element buffer object. Ignored if eboId is 0.
+	*/
+	void adopt(GLuint vboId, GLuint eboId, unsigned vertexCount, unsigned elementCount) {
+		checkGLError("Buffer::adopt(..) VBO Id " + to_string(m_vboId) + " -> Error occurred before this call");
+
+		// Exchange the vertex buffer and set all attributes again, because they still point to the old one
+		GLState::bindVertexArray(m_vaoId);
+		if (vboId != 0) {
+			GLState::deleteBuffers(1, &m_vboId);
+			m_vboId = vboId;
+			m_vertexCount = vertexCount;
+			GLState::bindBuffer(GL_ARRAY_BUFFER, m_vboId);
+			for (const Attrib &a : m_attribs)
+				glVertexAttribPointer(a.location, a.elementCount, a.type, a.normalized, a.stride, (const void*)a.offset);
+		}
+
+		// The element buffer binding is stored in the vertex array object
+		if (eboId != 0) {
+			if (m_eboActive)
+				GLState::deleteBuffers(1, &m_eboId);
+			m_eboId = eboId;
+			m_elementCount = elementCount;
+			m_eboActive = true;
+			GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_eboId);
+		}
+		checkGLError("Buffer::adopt(..) VBO Id " + to_string(m_vboId));
+	}
+
+	/**
+	* \brief Binds vertex or element buffer and uses them. Bindings that are already current are skipped.
 	*/
 	void use() {
-		glBindVertexArray(m_vaoId);
-		glBindBuffer(GL_ARRAY_BUFFER, m_vboId);
+		GLState::bindVertexArray(m_vaoId);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, m_vboId);
 		if (m_eboActive)
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_eboId);
+			GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_eboId);
 	}
 
 	/**
@@ -260,10 +430,14 @@ public:
 		// Check if any OpenGL errors happened before this code block is called. Used to clear the error buffer.
 		checkGLError("Buffer(size, vertexSize, usage) -> Error occurred before this call");
 
-		glDeleteBuffers(1, &m_vboId);
+		GLState::deleteBuffers(1, &m_vboId);
 		checkGLError("Buffer::~Buffer VBO Id " + to_string(m_vboId));
+		if (m_streamId != 0) {
+			GLState::deleteBuffers(1, &m_streamId);
+			checkGLError("Buffer::~Buffer Stream Id " + to_string(m_streamId));
+		}
 		if (m_eboActive) {
-			glDeleteBuffers(1, &m_eboId);
+			GLState::deleteBuffers(1, &m_eboId);
 			checkGLError("Buffer::~Buffer EBO Id " + to_string(m_vboId));
 		}
 	}
@@ -273,7 +447,24 @@ public:
 	*/
 	unsigned getVertexCount()const { return m_vertexCount; }
 
+	/**
+	* \brief Getter for the element count.
+	*/
+	unsigned getElementCount()const { return m_elementCount; }
+
 private:
+	/**
+	* \brief Layout of one attribute, as it was set with "attrib()".
+	*/
+	struct Attrib {
+		GLint location;
+		GLint elementCount;
+		GLenum type;
+		GLboolean normalized;
+		GLsizei stride;
+		GLintptr offset;
+	};
+
 	/**
 	* \brief Id for the vertex array object. This array stores the links between all 
 	* created attributes and their belonged VBO. Then there is no need of creating new
@@ -302,6 +493,26 @@ private:
 	*/
 	unsigned m_vertexCount;
 
+	/**
+	* \brief Number of elements stored in the element buffer.
+	*/
+	unsigned m_elementCount;
+
+	/**
+	* \brief All attributes that were set for the vertex buffer.
+	*/
+	vector<Attrib> m_attribs;
+
+	/**
+	* \brief Id for the stream buffer object. 0 if there is none.
+	*/
+	GLuint m_streamId;
+
+	/**
+	* \brief All attributes that are read from the stream buffer object.
+	*/
+	vector<Attrib> m_streamAttribs;
+
 	/**
 	* \brief Boolean that tells, when an element buffer is used.
 	*/
@@ -6,7 +6,7 @@
  * \brief Enumeration class for the possible states a button object could be in
  */
 enum class StateId {
-	Mouseover, Pressed, Released, None
+	Mouseover, Pressed, None
 };
 
 /**
@@ -14,8 +14,8 @@ enum class StateId {
  * 
  * A button object can be used to simply trigger special events. It can be in 3 possible states.
  * When it is in 'Mouseover' state, the color of the button gets highlighted. The 'Pressed' state 
- * says that it is currently pressed down. When it is released, the button is in the 'Released' state
- * until the next loop run.
+ * says that it is currently pressed down. The states are set by the dispatcher of the gui, which
+ * also runs the actions of the buttons.
  */
 class Button: public Block{
     public:
@@ -38,13 +38,20 @@ class Button: public Block{
         const StateId getState()const {return m_state;}
 
 		/**
-		 * \brief Draws the button considering it's color based on the state.
+		 * \brief Sets the state of the button.
+		 *
+		 * \param[in] state The new state.
+		 */
+        void setState(StateId state) { m_state = state; }
+
+		/**
+		 * \brief Adds the button to the gui batch considering it's color based on the state.
 		 */
         void update();
 
     private:
 		/**
-		 * \brief State the button is in based on the current context.
+		 * \brief State the button is in based on the mouse events.
 		 */
         StateId m_state;
 };
\ No newline at end of file
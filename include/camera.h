@@ -32,6 +32,15 @@ public:
 	*/
 	void update();
 
+	/**
+	* \brief Changes the shader program the camera uploads to, e.g. when the terrain uses another
+	* variant of its shader. Uploads the matrix, the camera position and the light direction to the
+	* new program, which needs to be in use. Nothing happens if the program did not change.
+	*
+	* \param[in] programId Id of the shader program.
+	*/
+	void setProgram(GLuint programId);
+
 private:
 	/**
 	* \brief Position in 3D-space.
@@ -125,5 +134,10 @@ private:
 	* \brief Location id for the light direction in the shader program.
 	*/
 	GLuint m_lightLoc;
+
+	/**
+	* \brief Id of the shader program the camera uploads to.
+	*/
+	GLuint m_programId;
 };
 
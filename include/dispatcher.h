@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <SDL.h>
+
+#include "button.h"
+#include "error.h"
+
+/**
+* \brief Groups of buttons that are enabled or disabled together. Where buttons of several groups
+* overlap, the button of the later group is hit, because it is drawn on top.
+*/
+enum class ButtonGroup {
+	Main, Terrain, Noise, Count
+};
+
+/**
+* \brief The Dispatcher class.
+*
+* Dispatches the mouse events of the window to the buttons of the gui. Every button is registered
+* once with an action and gets an integer handle. The buttons are sorted into the cells of a grid,
+* so that a mouse event only tests the few buttons of one cell. The states of the buttons are only
+* changed by events, and actions run when a button is clicked, or every frame while it is held
+* down for buttons that repeat. Therefore the work per frame does not grow with the number of buttons.
+*/
+class Dispatcher {
+public:
+	/**
+	* \brief Handle that is not assigned to any button.
+	*/
+	static const unsigned NoButton = ~0u;
+
+	/**
+	* \brief Constructs an empty dispatcher.
+	*
+	* \param[in] cellSize Width and height of one cell of the grid in pixels.
+	*/
+	Dispatcher(unsigned cellSize = 32);
+
+	/**
+	* \brief Registers a button. The button must not be moved afterwards.
+	*
+	* \param[in] button The button.
+	*
+	* \param[in] group Group of the button.
+	*
+	* \param[in] action Function that runs when the button is clicked.
+	*
+	* \param[in] repeat Whether the action runs every frame while the button is held down instead
+	* of once when it is released.
+	*
+	* \return Handle of the button.
+	*/
+	unsigned add(Button *button, ButtonGroup group, function<void()> action, bool repeat = false);
+
+	/**
+	* \brief Enables or disables all buttons of a group. Disabled buttons are not hit and lose their
+	* mouse over and pressed states.
+	*
+	* \param[in] group The group.
+	*
+	* \param[in] enabled Whether the group is enabled.
+	*/
+	void setEnabled(ButtonGroup group, bool enabled);
+
+	/**
+	* \brief Changes the states of the buttons according to the mouse events of a frame and runs the
+	* actions of clicked buttons.
+	*
+	* \param[in] events Mouse motion and mouse button events of the frame.
+	*/
+	void handle(const vector<SDL_Event> &events);
+
+	/**
+	* \brief Runs the action of the held button, if it repeats. Needs to be called once per frame.
+	*/
+	void update();
+
+	/**
+	* \brief Resets the mouse over and pressed states, e.g. when the gui is hidden.
+	*/
+	void reset();
+
+	/**
+	* \brief Getter for the button with the given handle.
+	*
+	* \param[in] handle Handle returned by "add()".
+	*/
+	Button* getButton(unsigned handle)const;
+
+private:
+	/**
+	* \brief A registered button.
+	*/
+	struct Entry {
+		Button *button;
+		ButtonGroup group;
+		function<void()> action;
+		bool repeat;
+	};
+
+	/**
+	* \brief Returns the handle of the enabled button at the given position or "NoButton".
+	*
+	* \param[in] x Position on x-axis relative to the window.
+	*
+	* \param[in] y Position on y-axis relative to the window.
+	*/
+	unsigned hit(int x, int y)const;
+
+	/**
+	* \brief Sets the state of a button from the hovered and the pressed button. A changed state
+	* invalidates the gui batch.
+	*
+	* \param[in] handle Handle of the button, "NoButton" is ignored.
+	*/
+	void refresh(unsigned handle);
+
+	/**
+	* \brief Key of the cell at the given cell coordinates.
+	*/
+	static unsigned cellKey(int cx, int cy) { return unsigned(cx) << 16 | unsigned(cy); }
+
+	/**
+	* \brief All registered buttons, indexed by their handles.
+	*/
+	vector<Entry> m_entries;
+
+	/**
+	* \brief Handles of the buttons that overlap a cell, in the order they were registered.
+	*/
+	unordered_map<unsigned, vector<unsigned>> m_cells;
+
+	/**
+	* \brief Width and height of a cell in pixels.
+	*/
+	unsigned m_cellSize;
+
+	/**
+	* \brief Whether the groups are enabled.
+	*/
+	bool m_enabled[unsigned(ButtonGroup::Count)];
+
+	/**
+	* \brief Handle of the button under the mouse.
+	*/
+	unsigned m_hovered;
+
+	/**
+	* \brief Handle of the button the left mouse button was pressed on.
+	*/
+	unsigned m_pressed;
+};
@@ -3,6 +3,7 @@
 #include <GL/glew.h>
 #include <string>
 #include <iostream>
+#include <atomic>
 
 using namespace std;
 
@@ -33,14 +34,44 @@ extern inline void printCriticalError(const string pos, const string msg) {
 	exit(EXIT_FAILURE);
 }
 
+/**
+* \brief Whether "checkGLError()" is compiled in. glGetError waits for the OpenGL pipeline on many
+* drivers, therefore it is compiled out of release builds, unless GL_ERROR_POLLING is defined as 1.
+*/
+#ifndef GL_ERROR_POLLING
+#ifdef NDEBUG
+#define GL_ERROR_POLLING 0
+#else
+#define GL_ERROR_POLLING 1
+#endif
+#endif
+
+/**
+* \brief Returns the flag that tells whether "checkGLError()" polls glGetError at runtime. It is
+* cleared as soon as the driver reports the errors through the debug output.
+*/
+inline atomic<bool>& getGLErrorPolling() {
+	static atomic<bool> polling(true);
+	return polling;
+}
+
+/**
+* \brief Enables or disables polling glGetError in "checkGLError()" at runtime.
+*
+* \param[in] enabled Whether the errors are polled.
+*/
+inline void setGLErrorPolling(bool enabled) {
+	getGLErrorPolling() = enabled;
+}
+
 /**
 * \brief Function for printing Error messages that are returned by glGetError().
 * Will be implemented once in the "error.cpp" file. Marked as inline to avoid
-* memory usage for the function.
+* memory usage for the function. Called by "checkGLError()".
 *
 * \param[in] pos String that should mark the position, where the error occurred.
 */
-extern inline void checkGLError(const string pos) {
+extern inline void pollGLError(const string &pos) {
 	GLenum err(glGetError());
 
 	if (err != GL_NO_ERROR) {
@@ -62,3 +93,49 @@ extern inline void checkGLError(const string pos) {
 		cerr << "OpenGL Error at: " << pos << ":\n\n" << errorText << "\n\n";
 	}
 }
+
+/**
+* \brief Prints the error returned by glGetError() together with the position. The position is only
+* constructed if polling is compiled in and enabled, so that no strings are built in release builds.
+*
+* \param[in] pos String that should mark the position, where the error occurred.
+*/
+#if GL_ERROR_POLLING
+#define checkGLError(pos) do { if (getGLErrorPolling()) pollGLError(pos); } while (false)
+#else
+#define checkGLError(pos) do {} while (false)
+#endif
+
+/**
+* \brief Callback of the debug output, which prints errors and warnings of the driver. It may be
+* called by any thread of the driver, some time after the call that caused the message.
+*/
+inline void GLAPIENTRY reportGLDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity,
+	GLsizei length, const GLchar *message, const void *userParam) {
+	// Notifications and hints of low severity, e.g. about the memory a buffer is placed in, are ignored
+	if (type != GL_DEBUG_TYPE_ERROR && severity != GL_DEBUG_SEVERITY_HIGH && severity != GL_DEBUG_SEVERITY_MEDIUM)
+		return;
+	cerr << (type == GL_DEBUG_TYPE_ERROR ? "OpenGL Error " : "OpenGL Warning ") << id << ":\n\n" << message << "\n\n";
+}
+
+/**
+* \brief Installs "reportGLDebugMessage()" as callback of the debug output of the current context,
+* if KHR_debug or ARB_debug_output is supported. The messages are reported asynchronously.
+*
+* \return True if the context is a debug context, which reports all errors through the callback.
+*/
+inline bool enableGLDebugOutput() {
+	if (GLEW_KHR_debug) {
+		glDebugMessageCallback(reportGLDebugMessage, nullptr);
+		glEnable(GL_DEBUG_OUTPUT);
+	}
+	else if (GLEW_ARB_debug_output)
+		glDebugMessageCallbackARB(reportGLDebugMessage, nullptr);
+	else
+		return false;
+
+	// Without a debug context the driver does not need to report anything
+	GLint flags = 0;
+	glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+	return (flags & GL_CONTEXT_FLAG_DEBUG_BIT) != 0;
+}
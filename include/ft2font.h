@@ -2,12 +2,54 @@
 
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
 #include <ft2build.h>
 #include "error.h"
+#include "guibatch.h"
 #include FT_FREETYPE_H
 
+/**
+* \brief A glyph that was rendered once and stored in the gui atlas.
+*/
+struct Glyph {
+	/**
+	* \brief Horizontal distance from the pen position to the left edge of the bitmap in pixels.
+	*/
+	int left;
+
+	/**
+	* \brief Vertical distance from the baseline to the top edge of the bitmap in pixels.
+	*/
+	int top;
+
+	/**
+	* \brief Width of the bitmap in pixels.
+	*/
+	unsigned width;
+
+	/**
+	* \brief Height of the bitmap in pixels.
+	*/
+	unsigned height;
+
+	/**
+	* \brief Distance to the pen position of the next glyph in pixels.
+	*/
+	int advance;
+
+	/**
+	* \brief Texture coordinates of the bitmap's area in the atlas.
+	*/
+	vec4 texCoords;
+};
+
 /**
 * \brief Font class for loading fonts and render their glyphs with a specific size.
+*
+* Every glyph is rendered only once per size. Its bitmap is stored in the atlas of the gui batch
+* and its metrics are kept in a cache, so that texts are laid out without calling freetype again.
 */
 class Font {
 public:
@@ -37,18 +79,43 @@ public:
 	FT_Face getFace() { return m_face; }
 
 	/**
-	* \brief Sets the size of the font glyphs.
+	* \brief Sets the size of the font glyphs. Glyphs of the former size stay in the cache.
 	*
 	* \param[in] s Given size.
 	*/
 	void setSize(FT_UInt size);
 
+	/**
+	* \brief Returns the glyph of a character with the current size. If it is not in the cache yet,
+	* it is rendered and its bitmap is stored in the atlas.
+	*
+	* \param[in] c The character.
+	*
+	* \param[in] atlas Gui batch whose atlas stores the bitmap.
+	*/
+	const Glyph& getGlyph(wchar_t c, GuiBatch &atlas);
+
+	/**
+	* \brief Returns the distance from the baseline to the bottom of the lowest glyph, as a positive number.
+	*/
+	unsigned getDescent()const { return m_descent; }
+
+	/**
+	* \brief Returns the height of a line of text.
+	*/
+	unsigned getLineHeight()const { return m_lineHeight; }
+
 	/**
 	* \brief Deletes the face, in which the glyphs were loaded.
 	*/
 	~Font();
 
 private:
+	/**
+	* \brief Reads the descent and line height of the current size from the face.
+	*/
+	void updateMetrics();
+
 	/**
 	* \brief The freetype face object, in which the glyphs will be loaded one
 	*        after the other.
@@ -59,27 +126,59 @@ private:
 	* \brief Size of the font glyphs.
 	*/
 	FT_UInt m_size;
+
+	/**
+	* \brief Descent of the current size in pixels.
+	*/
+	unsigned m_descent;
+
+	/**
+	* \brief Line height of the current size in pixels.
+	*/
+	unsigned m_lineHeight;
+
+	/**
+	* \brief Cached glyphs. The key holds the size in the upper and the character in the lower 32 bits.
+	*/
+	unordered_map<unsigned long long, Glyph> m_glyphs;
 };
 
 /**
-* \brief Utility class to create lines of text in form of a pixmap.
+* \brief Utility class to lay out a line of text as quads of cached glyphs.
 */
 class Text {
 public:
 	/**
-	* \brief Constructs the text and loads each letter one by one into the given
-	*        Font object.
+	* \brief Position of one glyph of the text.
+	*/
+	struct Quad {
+		/**
+		* \brief Left and bottom edge relative to the bottom left corner of the text in pixels.
+		*/
+		int x, y;
+
+		/**
+		* \brief The glyph.
+		*/
+		const Glyph *glyph;
+	};
+
+	/**
+	* \brief Constructs the text and lays out its characters one by one with the glyphs
+	*        of the given font.
 	*
-	* \param[in] text String that will be rendered in a line.
+	* \param[in] text String that will be laid out in a line.
 	*
-	* \param[in] font Font object, in which the text letters will be stored.
+	* \param[in] font Font object, which provides the glyphs.
+	*
+	* \param[in] atlas Gui batch whose atlas stores glyphs that were not rendered before.
 	*/
-	Text(wstring text, Font& font);
+	Text(wstring text, Font& font, GuiBatch &atlas);
 
 	/**
-	* \brief Getter for the pixel data pointer.
+	* \brief Getter for the quads of all visible glyphs.
 	*/
-	unsigned char* getPixmap() { return m_pixmap; }
+	const vector<Quad>& getQuads() { return m_quads; }
 
 	/**
 	* \brief Getter for the text's string.
@@ -97,11 +196,6 @@ public:
 	*/
 	unsigned getHeight() { return m_height; }
 
-	/**
-	* \brief Deletes the pixel data.
-	*/
-	~Text();
-
 private:
 	/**
 	* \brief String that holds the text.
@@ -109,23 +203,17 @@ private:
 	wstring m_text;
 
 	/**
-	* \brief Pointer to the pixel data of the text.
+	* \brief Quads of all glyphs with a bitmap.
 	*/
-	unsigned char* m_pixmap;
+	vector<Quad> m_quads;
 
 	/**
-	* \brief Width of the text, defined by the sum of each characters width.
-	*
-	*	A characters width in freetype is specified in 1/64th of points. A point
-	*  is a physical distance, equaling 1/72th of an inch.
+	* \brief Width of the text, defined by the sum of each characters advance in pixels.
 	*/
 	unsigned m_width;
 
 	/**
 	* \brief Height of the text, defined by the font object.
-	*
-	* A characters height in freetype is specified in 1/64th of points. A point
-	* is a physical distance, equaling 1/72th of an inch.
 	*/
 	unsigned m_height;
 };
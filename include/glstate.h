@@ -0,0 +1,189 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <GL/glew.h>
+
+using namespace std;
+
+/**
+* \brief The GLState class.
+*
+* Thin tracker in front of the OpenGL calls that change bindings. It remembers the current program,
+* vertex array object, buffer bindings, active texture unit and the texture bound to every unit, and
+* only calls OpenGL when the requested state differs from the current one. Uniform locations are
+* cached per program, so that they are only queried once.
+*
+* Every thread with an OpenGL context has its own state, because bindings are not shared between
+* contexts. Objects must be deleted with the delete functions of this class. A deletion clears the
+* states of all threads, because a deleted name may be generated again by any context, while
+* another context still has the deleted object bound.
+*/
+class GLState {
+public:
+	/**
+	* \brief Uses the given program with glUseProgram, if it is not used already.
+	*
+	* \param[in] program Id of the shader program.
+	*/
+	static void useProgram(GLuint program);
+
+	/**
+	* \brief Binds the given vertex array object, if it is not bound already.
+	*
+	* \param[in] vao Id of the vertex array object.
+	*/
+	static void bindVertexArray(GLuint vao);
+
+	/**
+	* \brief Binds a buffer object to a target. Bindings of GL_ARRAY_BUFFER and GL_ELEMENT_ARRAY_BUFFER
+	* are tracked, the element buffer per vertex array object. All other targets are always bound.
+	*
+	* \param[in] target Target the buffer object is bound to.
+	*
+	* \param[in] buffer Id of the buffer object.
+	*/
+	static void bindBuffer(GLenum target, GLuint buffer);
+
+	/**
+	* \brief Binds a texture to GL_TEXTURE_2D of a texture unit for drawing. The active texture unit
+	* is only changed if the texture needs to be bound.
+	*
+	* \param[in] unit The texture unit.
+	*
+	* \param[in] texture Id of the texture.
+	*/
+	static void bindTexture(GLuint unit, GLuint texture);
+
+	/**
+	* \brief Binds a texture to GL_TEXTURE_2D of a texture unit and makes the unit active, so that
+	* the texture can be modified, e.g. with glTexParameteri or glTexSubImage2D.
+	*
+	* \param[in] unit The texture unit.
+	*
+	* \param[in] texture Id of the texture.
+	*/
+	static void selectTexture(GLuint unit, GLuint texture);
+
+	/**
+	* \brief Returns the location of a uniform of a program. It is queried from OpenGL only the
+	* first time.
+	*
+	* \param[in] program Id of the shader program.
+	*
+	* \param[in] name Name of the uniform.
+	*/
+	static GLint getUniformLocation(GLuint program, const string &name);
+
+	/**
+	* \brief Deletes a program and forgets its uniform locations.
+	*/
+	static void deleteProgram(GLuint program);
+
+	/**
+	* \brief Deletes vertex array objects.
+	*/
+	static void deleteVertexArrays(GLsizei n, const GLuint *vaos);
+
+	/**
+	* \brief Deletes buffer objects.
+	*/
+	static void deleteBuffers(GLsizei n, const GLuint *buffers);
+
+	/**
+	* \brief Deletes textures.
+	*/
+	static void deleteTextures(GLsizei n, const GLuint *textures);
+
+	/**
+	* \brief Forgets the state of the calling thread, e.g. after another context was made current.
+	* The next call of every kind is passed to OpenGL.
+	*/
+	static void invalidate();
+
+	/**
+	* \brief Getter for the number of calls of the calling thread that were passed to OpenGL since
+	* the last call to "resetCounters()".
+	*/
+	static unsigned getIssued() { return s_state.issued; }
+
+	/**
+	* \brief Getter for the number of calls of the calling thread that were skipped, because they
+	* would not have changed anything, since the last call to "resetCounters()".
+	*/
+	static unsigned getSkipped() { return s_state.skipped; }
+
+	/**
+	* \brief Sets the counters of the calling thread to 0.
+	*/
+	static void resetCounters();
+
+private:
+	/**
+	* \brief Value of a binding that is not known, e.g. before the first call.
+	*/
+	static const GLuint Unknown = ~0u;
+
+	/**
+	* \brief Number of texture units that are tracked. Units above are always bound.
+	*/
+	static const GLuint TrackedUnits = 16;
+
+	/**
+	* \brief The bindings of one context.
+	*/
+	struct State {
+		State();
+
+		/**
+		* \brief Sets all bindings to "Unknown".
+		*/
+		void clear();
+
+		GLuint program;
+		GLuint vertexArray;
+		GLuint arrayBuffer;
+		GLuint activeUnit;
+		GLuint textures[TrackedUnits];
+
+		/**
+		* \brief Element buffer of every vertex array object, which stores this binding.
+		*/
+		unordered_map<GLuint, GLuint> elementBuffers;
+
+		/**
+		* \brief Uniform locations, by program and name.
+		*/
+		unordered_map<GLuint, unordered_map<string, GLint>> uniforms;
+
+		/**
+		* \brief Value of "s_deletions" when the state was checked the last time.
+		*/
+		unsigned deletions;
+
+		unsigned issued;
+		unsigned skipped;
+	};
+
+	/**
+	* \brief Returns the state of the calling thread, which is cleared first if any object was
+	* deleted since the last call.
+	*/
+	static State& current();
+
+	/**
+	* \brief Makes a texture unit active, if it is not active already.
+	*/
+	static void activeTexture(State &state, GLuint unit);
+
+	/**
+	* \brief State of the context of the calling thread.
+	*/
+	static thread_local State s_state;
+
+	/**
+	* \brief Number of deletions of all threads.
+	*/
+	static atomic<unsigned> s_deletions;
+};
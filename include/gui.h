@@ -1,20 +1,27 @@
 #pragma once
 
+#include <cstring>
+
 #include "button.h"
 #include "panel.h"
 #include "label.h"
 #include "ft2font.h"
 #include "terrain.h"
+#include "loader.h"
 #include "noise.h"
 #include "error.h"
+#include "dispatcher.h"
+#include "glstate.h"
+#include "profiler.h"
 
 /**
 * \brief The graphical user interface class.
 *
 * All buttons labels and panels that are seen in the application are created
 * when an object of it is made. So there should be only one instance of this
-* class in the whole application. Through the 'update'-functions all gui events
-* are handled. The methods to handle these events are also implemented here.
+* class in the whole application. Every button is registered with its action at
+* a dispatcher, which handles the mouse events in the 'update'-function. The
+* methods to handle these events are also implemented here.
 */
 class Gui {
 public:
@@ -31,34 +38,45 @@ public:
 	~Gui();
 
 	/**
-	* \brief Update function to handle the most of the gui events, specially the terrain and noise modifier.
+	* \brief Update function to handle the mouse events of a frame. Runs the actions of the clicked
+	* buttons and of held buttons that repeat, e.g. for the surface size or the brightness.
+	*
+	* \param[in] events Mouse events of the frame.
+	*
+	* \param[in] active Whether the cursor is shown. Otherwise the events are ignored.
+	*
+	* \param[in] editable Whether the terrain may be modified. The terrain must not be modified while
+	* the loader uses it.
 	*/
-	void update();
+	void update(const vector<SDL_Event> &events, bool active, bool editable);
 
 	/**
-	* \brief Update function to handle the brightness changing event.
+	* \brief Sets the function that runs when the button 'Generieren' was clicked.
+	*
+	* \param[in] action The function, usually calls "generateTerrain()".
 	*/
-	void updateBrightness();
+	void setGenerateAction(function<void()> action) { m_generateAction = action; }
 
 	/**
-	* \brief Update function to handle enabling/disabling event for the seamless noise texture.
+	* \brief Getter for the boolean that tells whether the button 'Generieren' is held down.
 	*/
-	void updateTextureEnabling();
+	bool getGeneratePressed()const { return m_dispatcher.getButton(m_generateButton)->getState() == StateId::Pressed; }
 
 	/**
-	* \brief Update function to handle events, happening in the panel from
-	* which the user can change the noise type. The user can change between
-	* billowy, ridgid, cosinus and normal perlin noise.
+	* \brief Update function to handle events, happening in the information
+	* panel in the top right corner of the window. Updates the OpenGL state changes
+	* and the frame times once per second. By pressing 'I' the user can hide or show
+	* the information panel.
+	*
+	* \param[in] profiler Profiler of the main loop, whose frame times are shown as text and as a graph.
 	*/
-	void updateNoisePanelEvents();
+	void updateInfo(const Profiler &profiler);
 
 	/**
-	* \brief Update function to handle events, happening in the information
-	* panel in the top right corner of the window. Updates the FPS everytime
-	* they change. By pressing 'I' the user can hide or show the information
-	* panel.
+	* \brief Adds the graph of the frame times to the gui batch, if the information panel is shown.
+	* Like the "update()" methods of the blocks it is only called when the gui batch collects quads.
 	*/
-	void updateInfo();
+	void updateFrameGraph();
 
 	/**
 	* \brief Reorders the information- and 'noise-type'-panel when the window was resized.
@@ -67,13 +85,38 @@ public:
 
 	/**
 	* \brief Generates a new terrain based on the input the user made. It is called
-	* when the button 'Generieren' was clicked.
+	* when the button 'Generieren' was clicked. The calculation and the upload run as a job
+	* of the loader. Only the heights are uploaded again, the grid and the elements only
+	* when the vertex count changed. The textures and buffers are exchanged when the job has
+	* finished, until then the old terrain is drawn. The terrain must not be modified while
+	* the job is pending.
 	*
 	* \param[in] normalTexture Reference of the normal map texture for overwriting it.
 	*
-	* \param[in] terrainBuffer Reference of the vertex buffer object of the terrain for overwriting it.
+	* \param[in] heightTexture Reference of the height texture for overwriting it. Only used
+	* with the vertex source HeightTexture.
+	*
+	* \param[in] terrainBuffer Pointer to the vertex buffer object of the terrain for overwriting it.
+	* Only used with the vertex source Streams, otherwise it may be nullptr.
+	*
+	* \param[in] loader Loader that runs the calculation and the upload.
+	*/
+	void generateTerrain(Texture &normalTexture, Texture &heightTexture, Buffer<vec2> *terrainBuffer, Loader &loader);
+
+	/**
+	* \brief Generates the seamless texture on a worker thread of the loader, so that the first frames
+	* do not wait for it. The texture is uploaded by the loader afterwards. Until then the seamless
+	* texture is disabled and the information panel shows that it's being generated.
+	*
+	* \param[in] seamlessTexture Reference of the seamless texture for overwriting it.
+	*
+	* \param[in] noise Seamless noise object for the texture. Must not be modified until the texture is ready.
+	*
+	* \param[in] resolution Pixel count in width and height.
+	*
+	* \param[in] loader Loader that uploads the texture.
 	*/
-	void generateTerrain(Texture &normalTexture, Buffer<Vertex> &terrainBuffer);
+	void generateSeamlessTexture(Texture &seamlessTexture, const Noise &noise, unsigned resolution, Loader &loader);
 
 	/**
 	* \brief Getter for the main panel on the left side of the window.
@@ -107,6 +150,11 @@ public:
 
 private:
 
+	/**
+	* \brief Registers all buttons with their actions at the dispatcher. Called once by the constructor.
+	*/
+	void registerButtons();
+
 	/**
 	* \brief Utility function to create the basic modifier layout of 2 buttons and a label.
 	* One button increases the value that wants to be modified and one decreases it.
@@ -135,7 +183,7 @@ private:
 
 	/**
 	* \brief Function for modifying vertex detail of the surface. The vertex count in
-	* width and in height is calculated with 128*vertexDetail.
+	* width and in height is calculated with 128*vertexDetail + 1.
 	*
 	* \param[in] value Value by which the vertex detail will be inc- or decreased.
 	*/
@@ -143,7 +191,7 @@ private:
 
 	/**
 	* \brief Function for modifying the resolution of the normal map. Pixel count in width
-	* and in height is calculated with 256*normalMapDetail.
+	* and in height is calculated with 256*normalMapDetail + 1.
 	*
 	* \param[in] value Value by which the normal map detail will be inc- or decreased.
 	*/
@@ -249,6 +297,12 @@ private:
 	*/
 	void activateTextureClicked();
 
+	/**
+	* \brief Enables the seamless texture, if the user did not disable it in the meantime, and shows
+	* that it's ready in the information panel. Called when the seamless texture was uploaded.
+	*/
+	void seamlessTextureReady();
+
 	/**
 	* \brief Pointer to the terrain to access it's data
 	*/
@@ -287,8 +341,50 @@ private:
 	*/
 	bool m_showInfo;
 
+	/**
+	* \brief Ticks of the last update of the OpenGL state changes in the information panel.
+	*/
+	Uint32 m_infoTicks;
+
+	/**
+	* \brief Number of frames since the last update of the OpenGL state changes.
+	*/
+	unsigned m_infoFrames;
+
+	/**
+	* \brief Frame times shown by the graph in the information panel. Only taken from the profiler
+	* once per second like the labels, which invalidate the gui batch when they change.
+	*/
+	vector<float> m_frameGraph;
+
 	/**
 	* \brief Boolean that tells whether the noise panel with it's buttons is shown or hidden.
 	*/
 	bool m_showNoisePanel;
+
+	/**
+	* \brief Boolean that tells whether the seamless texture was uploaded.
+	*/
+	bool m_seamlessTexReady;
+
+	/**
+	* \brief Boolean that tells whether the user wants the seamless texture to be shown. It is only
+	* applied to the terrain when the texture is ready.
+	*/
+	bool m_seamlessTexWanted;
+
+	/**
+	* \brief Dispatcher, which hit tests the buttons and runs their actions.
+	*/
+	Dispatcher m_dispatcher;
+
+	/**
+	* \brief Handle of the button 'Generieren'.
+	*/
+	unsigned m_generateButton;
+
+	/**
+	* \brief Function that runs when the button 'Generieren' was clicked.
+	*/
+	function<void()> m_generateAction;
 };
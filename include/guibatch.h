@@ -0,0 +1,269 @@
+#pragma once
+
+#include <vector>
+#include "error.h"
+#include "glm.h"
+#include "buffer.h"
+#include "texture.h"
+#include "shader.h"
+
+/**
+* \brief One corner of a quad of the gui. All members are floats, so that they can be set with
+* "Buffer::attrib()".
+*/
+struct GuiVertex {
+	/**
+	* \brief Position in OpenGL coordinates.
+	*/
+	vec2 position;
+
+	/**
+	* \brief Texture coordinate in the atlas.
+	*/
+	vec2 texCoord;
+
+	/**
+	* \brief Color of the quad, brightness included. Its alpha value is multiplied with the atlas texel.
+	*/
+	vec4 color;
+};
+
+/**
+* \brief Collects the quads of all gui blocks of a frame and draws them with a single draw call.
+*
+* The blocks do not own any buffer or texture, their "update()" methods only add quads to the
+* batch. The glyphs of all fonts are stored in one single channel atlas texture, which covers the
+* quads of the glyphs. The backgrounds of the blocks use a fully covered area of the atlas, so that
+* every quad is drawn the same way. The quads are drawn in the order they were added.
+*
+* The quads are not drawn onto the window directly, but into a layer texture with the size of
+* the window. The blocks only add their quads in frames in which "begin()" returns true, which is
+* the case after the batch was invalidated, e.g. by a changed text or hover state, or after the
+* window was resized. In all other frames nothing is collected and the cached layer is blended
+* onto the window, only within the regions covered by the quads of the last collected frame.
+*/
+class GuiBatch {
+public:
+	/**
+	* \brief Creates the vertex buffer, the element buffer and the atlas texture.
+	*
+	* \param[in] shader Gui shader program, which has the attributes 'position', 'texCoord' and 'color'.
+	*
+	* \param[in] texUnit Texture unit of the atlas.
+	*
+	* \param[in] layerUnit Texture unit of the cached layer.
+	*/
+	GuiBatch(const Shader *shader, GLuint texUnit, GLuint layerUnit);
+
+	/**
+	* \brief Deletes the buffers, the framebuffer and the textures.
+	*/
+	~GuiBatch();
+
+	/**
+	* \brief Allocates an area of the atlas. Areas are never released, because the glyphs stay in
+	* the cache of their font.
+	*
+	* \param[in] width Width of the area in pixels.
+	*
+	* \param[in] height Height of the area in pixels.
+	*
+	* \param[out] texCoords Texture coordinates of the bottom left and the top right corner of the area.
+	*
+	* \return False if the atlas is full.
+	*/
+	bool allocate(unsigned width, unsigned height, vec4 &texCoords);
+
+	/**
+	* \brief Overwrites an allocated area of the atlas.
+	*
+	* \param[in] coverage Pixel data with 1 byte per pixel, starting with the bottom row.
+	*
+	* \param[in] texCoords Texture coordinates of the area, as returned by "allocate()".
+	*
+	* \param[in] width Width of the area in pixels.
+	*
+	* \param[in] height Height of the area in pixels.
+	*/
+	void store(const GLubyte *coverage, const vec4 &texCoords, unsigned width, unsigned height);
+
+	/**
+	* \brief Marks the gui as changed, so that the quads are collected and drawn into the layer
+	* again in the next frame.
+	*/
+	void invalidate() { m_dirty = true; }
+
+	/**
+	* \brief Starts a frame. Recreates the layer if the window was resized.
+	*
+	* \return True if the blocks need to add their quads in this frame, because the batch was
+	* invalidated, the layer is empty or there is no framebuffer. Otherwise the quads of this frame
+	* are ignored and the cached layer is used.
+	*/
+	bool begin();
+
+	/**
+	* \brief Adds a quad to the batch.
+	*
+	* \param[in] corners Top left and bottom right corner in OpenGL coordinates.
+	*
+	* \param[in] texCoords Texture coordinates of the bottom left and the top right corner.
+	*
+	* \param[in] color Color of the quad. Its alpha value is multiplied with the atlas texels.
+	*/
+	void add(const vec2 corners[2], const vec4 &texCoords, const vec4 &color);
+
+	/**
+	* \brief Draws the quads that were added since "begin()" into the layer, if they were collected,
+	* and composites the regions of the layer onto the window. Uses the gui shader program and
+	* disables the depth test, so the gui is always in front of the terrain.
+	*/
+	void draw();
+
+	/**
+	* \brief Getter for the texture coordinates of the fully covered area, used for the backgrounds.
+	*/
+	const vec4& getWhite()const { return m_white; }
+
+	/**
+	* \brief Getter for the number of quads drawn by the last call to "draw()".
+	*/
+	unsigned getDrawnQuads()const { return m_drawnQuads; }
+
+	/**
+	* \brief Getter for the boolean that tells whether the last call to "draw()" drew the quads again.
+	*/
+	bool getRedrawn()const { return m_redrawn; }
+
+private:
+	/**
+	* \brief Recreates the vertex and element buffer with space for the given number of quads.
+	*
+	* \param[in] quads New number of quads.
+	*/
+	void reserve(unsigned quads);
+
+	/**
+	* \brief Uploads the quads of this frame and draws them into the bound framebuffer.
+	*
+	* \param[in] quads Number of quads.
+	*/
+	void drawQuads(unsigned quads);
+
+	/**
+	* \brief Merges the quads of this frame into non overlapping rectangles and uploads one quad per
+	* rectangle, with which the layer is composited. Overlapping quads are merged into their
+	* bounding rectangle, so no pixel of the window is blended twice. Clears the quads.
+	*/
+	void updateRegions();
+
+	/**
+	* \brief Creates the layer texture with the given size and attaches it to the framebuffer. If the
+	* framebuffer is incomplete, it is deleted and the quads are drawn directly.
+	*
+	* \param[in] width Width of the window.
+	*
+	* \param[in] height Height of the window.
+	*/
+	void createLayer(unsigned width, unsigned height);
+
+	/**
+	* \brief Width and height of the atlas in pixels.
+	*/
+	static const unsigned AtlasSize = 512;
+
+	/**
+	* \brief The gui shader program.
+	*/
+	const Shader *m_shader;
+
+	/**
+	* \brief Vertex buffer with 4 vertices per quad and element buffer with 6 elements per quad.
+	*/
+	Buffer<GuiVertex> *m_buffer;
+
+	/**
+	* \brief Atlas texture with the coverage of all glyphs.
+	*/
+	Texture *m_atlas;
+
+	/**
+	* \brief Vertices of the quads added in this frame.
+	*/
+	vector<GuiVertex> m_vertices;
+
+	/**
+	* \brief Number of quads that fit into the buffers.
+	*/
+	unsigned m_capacity;
+
+	/**
+	* \brief Number of quads drawn by the last call to "draw()".
+	*/
+	unsigned m_drawnQuads;
+
+	/**
+	* \brief Position of the next free area in the current row of areas in the atlas.
+	*/
+	unsigned m_shelfX, m_shelfY;
+
+	/**
+	* \brief Height of the highest area in the current row of areas.
+	*/
+	unsigned m_shelfHeight;
+
+	/**
+	* \brief Texture coordinates of the fully covered area.
+	*/
+	vec4 m_white;
+
+	/**
+	* \brief Framebuffer object with the layer as color attachment. 0 if it could not be created.
+	*/
+	GLuint m_framebuffer;
+
+	/**
+	* \brief The cached layer with premultiplied colors.
+	*/
+	Texture *m_layer;
+
+	/**
+	* \brief Texture unit of the layer.
+	*/
+	GLuint m_layerUnit;
+
+	/**
+	* \brief Boolean that tells whether the layer holds the cached quads. False after it was created.
+	*/
+	bool m_layerValid;
+
+	/**
+	* \brief Boolean that tells whether the last call to "draw()" drew the quads again.
+	*/
+	bool m_redrawn;
+
+	/**
+	* \brief Boolean that tells whether the gui changed since the quads were collected the last time.
+	*/
+	bool m_dirty;
+
+	/**
+	* \brief Boolean that tells whether the quads are collected in this frame, as returned by "begin()".
+	*/
+	bool m_collecting;
+
+	/**
+	* \brief Quads of the regions of the layer that are composited onto the window.
+	*/
+	Buffer<GuiVertex> *m_regionQuads;
+
+	/**
+	* \brief Number of quads in the region buffer.
+	*/
+	unsigned m_regionCount;
+
+	/**
+	* \brief Location of the 'composite' uniform, which tells the shader to sample the layer.
+	*/
+	GLint m_compositeLoc;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "glm.h"
+#include "error.h"
+
+/**
+* \brief The Heightfield class.
+*
+* Stores a two dimensional field of heights in square tiles of (TileSize x TileSize) values
+* instead of row by row. All values of a tile lie next to each other in memory, so stages that
+* read the neighbourhood of a value (normals, filtering, erosion) stay within a few cache lines
+* instead of touching three rows of a possibly very wide array. Every tile can be worked on on
+* its own, which also makes it natural to split such work into parallel jobs.
+*/
+class Heightfield
+{
+public:
+	/**
+	* \brief Number of values in width and height of one tile. Needs to be a power of two.
+	*/
+	static const unsigned TileSize = 32;
+
+	/**
+	* \brief Constructs an empty heightfield.
+	*/
+	Heightfield();
+
+	/**
+	* \brief Constructs a heightfield of the given size. All values are 0.
+	*
+	* \param[in] width Number of values in width.
+	*
+	* \param[in] height Number of values in height.
+	*/
+	Heightfield(unsigned width, unsigned height);
+
+	/**
+	* \brief Changes the size of the heightfield. The values are undefined afterwards.
+	*
+	* \param[in] width Number of values in width.
+	*
+	* \param[in] height Number of values in height.
+	*/
+	void resize(unsigned width, unsigned height);
+
+	/**
+	* \brief Returns a reference to the value at the given position.
+	*
+	* \param[in] x Position in width, from 0 to (width - 1).
+	*
+	* \param[in] y Position in height, from 0 to (height - 1).
+	*/
+	float& at(unsigned x, unsigned y) { return m_values[index(x, y)]; }
+
+	/**
+	* \brief Returns the value at the given position.
+	*
+	* \param[in] x Position in width, from 0 to (width - 1).
+	*
+	* \param[in] y Position in height, from 0 to (height - 1).
+	*/
+	float at(unsigned x, unsigned y)const { return m_values[index(x, y)]; }
+
+	/**
+	* \brief Getter for the number of values in width.
+	*/
+	unsigned getWidth()const { return m_width; }
+
+	/**
+	* \brief Getter for the number of values in height.
+	*/
+	unsigned getHeight()const { return m_height; }
+
+private:
+	/**
+	* \brief Returns the position of a value in memory. The tiles are stored row by row and
+	* the values within a tile as well.
+	*/
+	unsigned index(unsigned x, unsigned y)const {
+		return ((y / TileSize) * m_tilesX + x / TileSize) * (TileSize * TileSize) + (y % TileSize) * TileSize + x % TileSize;
+	}
+
+	/**
+	* \brief Number of values in width.
+	*/
+	unsigned m_width;
+
+	/**
+	* \brief Number of values in height.
+	*/
+	unsigned m_height;
+
+	/**
+	* \brief Number of tiles in width.
+	*/
+	unsigned m_tilesX;
+
+	/**
+	* \brief Number of tiles in height.
+	*/
+	unsigned m_tilesY;
+
+	/**
+	* \brief The values, tile by tile.
+	*/
+	vector<float> m_values;
+};
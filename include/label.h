@@ -25,7 +25,7 @@ class Label: public Block {
 		Label(int posX, int posY, unsigned width, unsigned height);
 
 		/**
-		* \brief Draws the label block.
+		* \brief Adds the label block to the gui batch.
 		*/
 		void update();
 };
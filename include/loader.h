@@ -0,0 +1,207 @@
+#pragma once
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <GL/glew.h>
+
+#include "window.h"
+#include "texture.h"
+#include "workerpool.h"
+#include "error.h"
+
+/**
+* \brief The Loader class.
+*
+* Runs texture and buffer uploads on a second thread with its own OpenGL context, which shares
+* its objects with the context of the main window. Every job consists of two parts. The first part
+* runs on the loader thread and creates the new OpenGL objects. After it finished, a fence is placed
+* into the loader's command stream. The second part runs on the render thread within "poll()", as
+* soon as the fence is signaled, and only exchanges the object handles. Thereby the render thread
+* never waits for loading, decoding or uploading data.
+*
+* Work that only needs the CPU, like decoding images, runs on the worker pool in front of the jobs
+* with "prepare()", so that it overlaps with the jobs of the loader thread and with each other.
+*
+* If no shared context can be created, or the loader is constructed with async set to false, both
+* parts run directly one after the other on the calling thread.
+*/
+class Loader
+{
+public:
+	/**
+	* \brief Creates the shared context and starts the loader thread.
+	*
+	* \param[in] window Window whose context is shared with the loader thread.
+	*
+	* \param[in] async Whether the jobs shall run on the loader thread or directly on the calling thread.
+	*/
+	Loader(Window &window, bool async = true);
+
+	/**
+	* \brief Waits for the prepared jobs, stops the loader thread after its current job and deletes
+	* the shared context. Jobs that did not finish yet are dropped, the objects created by jobs that
+	* ran on the loader thread are deleted with their discard function.
+	*/
+	~Loader();
+
+	/**
+	* \brief Adds a job to the queue of the loader thread.
+	*
+	* \param[in] job Function that runs on the loader thread. It may create and fill OpenGL objects,
+	* but must not use any state of the main context (bound program, vertex array objects, etc.).
+	*
+	* \param[in] done Function that runs on the render thread within "poll()" after all OpenGL commands
+	* of the job have been completed. Used to exchange the handles of the new objects.
+	*
+	* \param[in] discard Optional function that runs instead of "done" when the loader is destroyed
+	* after the job ran, but before it was finished by "poll()". Used to delete the new objects.
+	*/
+	void submit(function<void()> job, function<void()> done, function<void()> discard = nullptr);
+
+	/**
+	* \brief Utility function to create a texture on the loader thread, which replaces the
+	* given texture when it's ready.
+	*
+	* \param[in] target Texture that gets the texture object of the created texture.
+	*
+	* \param[in] create Function that creates the new texture on the loader thread.
+	*
+	* \param[in] ready Optional function that runs on the render thread after the texture was replaced.
+	*/
+	void loadTexture(Texture &target, function<Texture*()> create, function<void()> ready = nullptr);
+
+	/**
+	* \brief Utility function to load a texture from a file. The file is decoded on a worker thread,
+	* only the upload runs on the loader thread.
+	*
+	* \param[in] target Texture that gets the texture object of the loaded texture. Its unit is kept.
+	*
+	* \param[in] file Path to a '.bmp' file or a '.ktx' container.
+	*
+	* \param[in] wrapper See constructor 1 of the Texture class.
+	*
+	* \param[in] filter See constructor 1 of the Texture class.
+	*
+	* \param[in] ready Optional function that runs on the render thread after the texture was replaced.
+	*/
+	void loadTexture(Texture &target, const string &file, GLint wrapper, GLint filter, function<void()> ready = nullptr);
+
+	/**
+	* \brief Runs work without OpenGL on a thread of the worker pool and afterwards the given function on
+	* the same thread, which usually submits the job that uploads the result. Counts as pending until
+	* the given function returned, so the job it submits follows without a gap.
+	*
+	* \param[in] work Function that runs on the worker thread. Must not call OpenGL.
+	*
+	* \param[in] then Function that runs on the worker thread after the work, e.g. to call "submit()".
+	*/
+	void prepare(function<void()> work, function<void()> then);
+
+	/**
+	* \brief Runs the second part of all jobs whose OpenGL commands have been completed. Needs to be
+	* called once per frame on the render thread. The bound shader program may be changed by the jobs.
+	*/
+	void poll();
+
+	/**
+	* \brief Getter for the number of prepared and submitted jobs that have not been finished yet.
+	*/
+	unsigned getPending()const;
+
+	/**
+	* \brief Getter for the boolean that tells whether the jobs run on the loader thread.
+	*/
+	bool isAsync()const { return m_async; }
+
+private:
+	/**
+	* \brief A submitted job with its second part and the function that deletes its objects.
+	*/
+	struct Job {
+		function<void()> job, done, discard;
+	};
+
+	/**
+	* \brief A finished job, waiting for its fence.
+	*/
+	struct Completion {
+		GLsync fence;
+		function<void()> done, discard;
+	};
+
+	/**
+	* \brief Loop of the loader thread. Waits for jobs and runs them one after the other.
+	*/
+	void run();
+
+	/**
+	* \brief Window, whose context is shared.
+	*/
+	Window *m_window;
+
+	/**
+	* \brief The shared OpenGL context, which is current on the loader thread.
+	*/
+	SDL_GLContext m_context;
+
+	/**
+	* \brief Boolean that tells whether jobs run on the loader thread.
+	*/
+	bool m_async;
+
+	/**
+	* \brief Boolean that tells whether fences are supported. Otherwise the loader thread
+	* waits for the completion of its commands with glFinish.
+	*/
+	bool m_fences;
+
+	/**
+	* \brief Boolean that tells the loader thread to stop.
+	*/
+	bool m_stop;
+
+	/**
+	* \brief Number of prepared and submitted jobs that were not finished yet.
+	*/
+	unsigned m_pending;
+
+	/**
+	* \brief Number of prepared jobs whose work is still running on the worker pool.
+	*/
+	unsigned m_preparing;
+
+	/**
+	* \brief Jobs waiting to run on the loader thread.
+	*/
+	deque<Job> m_jobs;
+
+	/**
+	* \brief Jobs that ran on the loader thread, in the order they were submitted.
+	*/
+	deque<Completion> m_completions;
+
+	/**
+	* \brief Mutex for the job and completion queues.
+	*/
+	mutable mutex m_mutex;
+
+	/**
+	* \brief Wakes up the loader thread when a job was submitted or it shall stop.
+	*/
+	condition_variable m_wake;
+
+	/**
+	* \brief The loader thread.
+	*/
+	thread m_thread;
+
+	/**
+	* \brief Wakes up the destructor when the last prepared job finished.
+	*/
+	condition_variable m_prepared;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <GL/glew.h>
+
+#include "error.h"
+
+/**
+* \brief The MappedFile class.
+*
+* Maps a whole file read-only into memory. The pages are only read from the disk when they
+* are accessed, and they are not copied into a buffer of the application first. Used for
+* texture containers, whose levels are handed to OpenGL straight from the mapping.
+*/
+class MappedFile
+{
+public:
+	/**
+	* \brief Maps the given file. If it does not exist or cannot be mapped, the mapped file is
+	* empty, which can be checked with "isOpen()".
+	*
+	* \param[in] path Path to the file.
+	*/
+	MappedFile(const string &path);
+
+	/**
+	* \brief Unmaps the file.
+	*/
+	~MappedFile();
+
+	/**
+	* \brief Returns whether the file is mapped.
+	*/
+	bool isOpen()const { return m_data != nullptr; }
+
+	/**
+	* \brief Getter for the mapped content of the file.
+	*/
+	const GLubyte* getData()const { return m_data; }
+
+	/**
+	* \brief Getter for the size of the file in bytes.
+	*/
+	size_t getSize()const { return m_size; }
+
+private:
+	/**
+	* \brief Not copyable, the mapping belongs to one object.
+	*/
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	* \brief Start of the mapping, or nullptr.
+	*/
+	const GLubyte *m_data;
+
+	/**
+	* \brief Size of the file in bytes.
+	*/
+	size_t m_size;
+
+	/**
+	* \brief Handles of the file and of the mapping on Windows. Unused on other systems.
+	*/
+	void *m_file, *m_mapping;
+};
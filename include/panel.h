@@ -43,7 +43,7 @@ class Panel: public Block{
         void text(wstring t, Font& font);
 
 		/**
-		* \brief Draws the panel and all it's sub elements.
+		* \brief Adds the panel and all it's sub elements to the gui batch.
 		*/
         void update();
 
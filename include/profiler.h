@@ -0,0 +1,178 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <GL/glew.h>
+#include "error.h"
+
+/**
+* \brief Phases of the main loop whose CPU time is measured.
+*
+* Input covers the window events and the buffer swap, Loader the clearing of the window and the
+* jobs finished by the loader, Camera the camera update, Terrain the terrain draw call and Gui the
+* update and the draw call of the gui.
+*/
+enum class Phase {
+	Input, Loader, Camera, Terrain, Gui, Count
+};
+
+/**
+* \brief Passes of a frame whose GPU time is measured with timer queries.
+*/
+enum class Pass {
+	Terrain, Gui, Count
+};
+
+/**
+* \brief The Profiler class.
+*
+* Measures the CPU time of the phases of the main loop and the GPU time of the passes of every
+* frame and keeps them for the last "HistorySize" frames. The phases are measured one after the
+* other: "mark()" adds the time since the previous mark to a phase, so the phases of a frame sum
+* up to its frame time.
+*
+* The GPU times are measured with GL_TIME_ELAPSED queries, if GL_ARB_timer_query is supported. The
+* queries are double buffered: the results of a frame are read when its query objects are used
+* again two frames later, which is usually long after the GPU finished them. A result that is still
+* not available is dropped instead of waiting for it.
+*/
+class Profiler {
+public:
+	/**
+	* \brief Number of frames that are kept.
+	*/
+	static const unsigned HistorySize = 100;
+
+	/**
+	* \brief Creates the query objects, if timer queries are supported.
+	*/
+	Profiler();
+
+	/**
+	* \brief Deletes the query objects.
+	*/
+	~Profiler();
+
+	/**
+	* \brief Starts a new frame and stores the last one in the history. Reads the GPU times of the
+	* frame whose query objects are used next. Needs to be called before the main loop and at the end
+	* of every iteration, so that the window events and the buffer swap are part of the frame.
+	*/
+	void beginFrame();
+
+	/**
+	* \brief Adds the CPU time since the previous mark to a phase of the current frame.
+	*
+	* \param[in] phase The phase that just finished.
+	*/
+	void mark(Phase phase);
+
+	/**
+	* \brief Starts the timer query of a pass. Only one pass can be measured at a time.
+	*
+	* \param[in] pass The pass.
+	*/
+	void beginPass(Pass pass);
+
+	/**
+	* \brief Ends the timer query of the pass that was started last.
+	*/
+	void endPass();
+
+	/**
+	* \brief Returns the shortest, the average and the 99th percentile frame time of the history in
+	* milliseconds. All are 0 while the history is empty.
+	*/
+	void getFrameTimes(float &min, float &avg, float &p99)const;
+
+	/**
+	* \brief Returns the average CPU time of a phase in milliseconds.
+	*/
+	float getCpuTime(Phase phase)const;
+
+	/**
+	* \brief Returns the average GPU time of a pass in milliseconds or -1 if there is no result,
+	* e.g. because timer queries are not supported.
+	*/
+	float getGpuTime(Pass pass)const;
+
+	/**
+	* \brief Returns the frame times of the history in milliseconds, from the oldest to the latest frame.
+	*/
+	vector<float> getHistory()const;
+
+private:
+	/**
+	* \brief Times of one frame in milliseconds. GPU times are -1 until their results are read.
+	*/
+	struct Frame {
+		float total;
+		float cpu[unsigned(Phase::Count)];
+		float gpu[unsigned(Pass::Count)];
+	};
+
+	/**
+	* \brief Number of sets of query objects.
+	*/
+	static const unsigned QueryBuffers = 2;
+
+	/**
+	* \brief Reads the available results of a set of query objects into the frame they were issued in.
+	*
+	* \param[in] buffer Index of the set.
+	*/
+	void readQueries(unsigned buffer);
+
+	/**
+	* \brief Frames of the history, used as a ring buffer.
+	*/
+	vector<Frame> m_history;
+
+	/**
+	* \brief Number of frames stored in the history, at most "HistorySize".
+	*/
+	unsigned m_frames;
+
+	/**
+	* \brief Index of the current frame in the history.
+	*/
+	unsigned m_current;
+
+	/**
+	* \brief Start of the current frame and time of the last mark.
+	*/
+	chrono::steady_clock::time_point m_frameStart, m_lastMark;
+
+	/**
+	* \brief Whether "beginFrame()" was called before.
+	*/
+	bool m_started;
+
+	/**
+	* \brief Whether timer queries are supported.
+	*/
+	bool m_timerQueries;
+
+	/**
+	* \brief Query objects of every pass for every set.
+	*/
+	GLuint m_queries[QueryBuffers][unsigned(Pass::Count)];
+
+	/**
+	* \brief Whether the query of a pass was issued with a set, and the history index of the frame
+	* it was issued in.
+	*/
+	bool m_issued[QueryBuffers][unsigned(Pass::Count)];
+	unsigned m_issuedFrame[QueryBuffers];
+
+	/**
+	* \brief Set of query objects of the current frame.
+	*/
+	unsigned m_buffer;
+
+	/**
+	* \brief Pass whose query is active, "Pass::Count" if none.
+	*/
+	Pass m_activePass;
+};
@@ -4,13 +4,22 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <iterator>
+#include <vector>
 #include <GL/glew.h>
 #include "error.h"
+#include "glstate.h"
 
 /**
 * \brief Utility class for loading and linking shader files to a shader program.
 *
-* Currently it supports loading vertex and fragment shader.
+* Currently it supports loading vertex and fragment shader. Linked programs can be cached as
+* program binaries, if the driver supports GL_ARB_get_program_binary. The cache is only used
+* when its key, a hash of the shader sources and the driver strings, matches. Otherwise the
+* shaders are compiled and the cache is written again.
+*
+* Variants of the same sources are compiled with preprocessor defines, which are inserted behind the
+* '#version' line of every shader. Each variant is a program of its own.
 */
 class Shader {
 
@@ -22,8 +31,13 @@ public:
 	* \param[in] vsh Relative path to vertex shader file.
 	*
 	* \param[in] fsh Relative path to fragment shader file.
+	*
+	* \param[in] cache Relative path to the file the program binary is cached in. If empty, the
+	* shaders are always compiled. Variants need files of their own, otherwise they overwrite each other.
+	*
+	* \param[in] defines Preprocessor defines of the variant, e.g. "SEAMLESS_DETAIL" or "NORMAL_ENCODING 2".
 	*/
-	Shader(string vsh, string fsh);
+	Shader(string vsh, string fsh, string cache = "", const vector<string> &defines = {});
 
 	/**
 	* \brief Deletes the shader program
@@ -31,9 +45,16 @@ public:
 	~Shader();
 
 	/**
-	* \brief Uses the shader program.
+	* \brief Uses the shader program, if it is not used already.
+	*/
+	void use()const { GLState::useProgram(m_id); }
+
+	/**
+	* \brief Returns the location of a uniform, which is only queried the first time.
+	*
+	* \param[in] name Name of the uniform.
 	*/
-	void use()const { glUseProgram(m_id); }
+	GLint getUniformLocation(const string &name)const { return GLState::getUniformLocation(m_id, name); }
 
 	/**
 	* \brief Getter for the shader id.
@@ -42,11 +63,57 @@ public:
 
 private:
 	/**
-	* \brief Loads and compiles a single shader file. This is used by the constructor above.
+	* \brief Compiles a single shader. This is used by the constructor above.
+	*
+	* \param[in] type Type of the shader, GL_VERTEX_SHADER or GL_FRAGMENT_SHADER.
+	*
+	* \param[in] source Source code of the shader with the defines of the variant.
+	*/
+	Shader(GLenum type, const string &source);
+
+	/**
+	* \brief Reads the source code of a shader file. Exits the application if the file does not exist.
 	*
 	* \param[in] path Path to the shader file.
 	*/
-	Shader(string path);
+	static string loadSource(const string &path);
+
+	/**
+	* \brief Inserts the defines behind the '#version' line of the source, which needs to stay the first
+	* line, or at the beginning if there is none.
+	*
+	* \param[in] source Source code of a shader.
+	*
+	* \param[in] defines Defines of the variant.
+	*/
+	static string defineSource(const string &source, const vector<string> &defines);
+
+	/**
+	* \brief Returns the key of the program binary cache, a 64 bit FNV-1a hash of the given
+	* sources, including the defines, and the vendor, renderer and version string of the driver.
+	*
+	* \param[in] sources Source code of all shaders of the program.
+	*/
+	static unsigned long long cacheKey(const string &sources);
+
+	/**
+	* \brief Loads the program binary from the cache file into the program, if the file's key matches
+	* and the driver accepts the binary. Returns whether the program is linked afterwards.
+	*
+	* \param[in] cache Path to the cache file.
+	*
+	* \param[in] key Key of the current sources and driver.
+	*/
+	bool loadBinary(const string &cache, unsigned long long key);
+
+	/**
+	* \brief Writes the binary of the linked program together with the key to the cache file.
+	*
+	* \param[in] cache Path to the cache file.
+	*
+	* \param[in] key Key of the current sources and driver.
+	*/
+	void saveBinary(const string &cache, unsigned long long key)const;
 
 	/**
 	* \brief Identification number for the shader
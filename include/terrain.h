@@ -2,22 +2,59 @@
 
 #include <chrono>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <map>
 #include <GL/glew.h>
 
 #include "noise.h"
 #include "glm.h"
 #include "texture.h"
+#include "heightfield.h"
+#include "workerpool.h"
 #include "error.h"
 
 /**
-* \brief Vertex class. 
-*
-* Just holds a 3D vector for the position and a 2D vector for the texture coordinate.
+* \brief Enumeration class for the formats in which the heights of the vertices are stored
+* in the height stream. Float stores the plain noise values. Unorm16 quantizes them to 16 bit
+* over the range [-amplitude, amplitude], which all noise values lie within.
 */
-struct Vertex{
-	vec3 pos;
-	vec2 texCoord;
-};
+enum class HeightFormat { Float, Unorm16 };
+
+/**
+* \brief Enumeration class for the ways the vertex shader gets the vertices of the terrain.
+* Streams reads the grid and the height stream from vertex buffer objects and draws them with
+* the element list. HeightTexture needs no vertex buffer and no element list at all. The vertex
+* shader derives the grid position from gl_VertexID and fetches the height from a single channel
+* height texture, so a new terrain only uploads that texture.
+*/
+enum class VertexSource { Streams, HeightTexture };
+
+/**
+* \brief Enumeration class for the orders of the triangle strips of the full grid. Rows draws one
+* strip per row over the whole width. Its vertices are evicted from the post-transform vertex cache
+* before the next row reuses them, so every vertex is shaded about twice. Blocks splits the grid
+* into stripes of (BlockSize) cells and draws the rows of one stripe after the other, so that the
+* shared vertices of two rows are still in the cache.
+*/
+enum class ElementOrder { Rows, Blocks };
+
+/**
+* \brief Enumeration class for the formats in which the normal map and the seamless map are
+* stored in their textures. Float stores all three components in 32 bit (GL_RGB32F). Snorm16
+* (GL_RG16_SNORM) and Unorm8 (GL_RG8) only store the x and z component, the y component, which
+* always points up, is reconstructed in the fragment shader. Octahedral stores the normal in
+* octahedral encoding in GL_RG16_SNORM, which spreads the precision evenly over all directions.
+* Rgtc2 stores x and z block compressed (GL_COMPRESSED_SIGNED_RG_RGTC2) with 1 byte per texel.
+*/
+enum class NormalFormat { Float, Snorm16, Unorm8, Octahedral, Rgtc2 };
 
 /**
 * \brief The Terrain class. 
@@ -29,6 +66,13 @@ struct Vertex{
 * does not contain a normal. This is because the normal data is stored in a texture 
 * that is applied to the terrain, which is a lot better for performance and allows
 * higher detailed lighting effects.
+*
+* The vertex data is split into two streams. The static grid stream only holds the texture
+* coordinate of each vertex and only changes with the vertex detail. The X- and Z-position
+* are derived from it in the vertex shader. The height stream holds one height per vertex
+* and is the only data that needs to be uploaded again when a new terrain is generated.
+* With the vertex source HeightTexture the heights are stored in a texture instead and the
+* terrain is drawn without any vertex data.
 */
 class Terrain
 {
@@ -45,41 +89,181 @@ public:
 	* \param[in] surfaceDepth Depth of the terrain.
 	*
 	* \param[in] vertexDetail Determines the total vertex count. The vertex count in width
-	* and height is calculated with (128*vertexDetail).
+	* and height is calculated with (128*vertexDetail + 1).
 	*
 	* \param[in] normalMapDetail Determines the pixel resoultion of the normal map texture.
-	* Pixel in width and height are calculated with (256*normalMapDetail).
+	* Pixel in width and height are calculated with (256*normalMapDetail + 1).
+	*
+	* \param[in] vsh Path to the vertex shader of the terrain.
 	*
-	* \param[in] programId Id of the shader program for the terrain.
+	* \param[in] fsh Path to the fragment shader of the terrain, which is compiled in variants.
+	*
+	* \param[in] cache Path to the program binary cache. Every variant gets its own file, named with
+	* the number of the variant in front of the extension. If empty, the shaders are always compiled.
 	*/
-	Terrain(Noise &noise, float surfaceWidth, float surfaceDepth, unsigned vertexDetail, unsigned normalMapDetail, const GLuint programId);
+	Terrain(Noise &noise, float surfaceWidth, float surfaceDepth, unsigned vertexDetail, unsigned normalMapDetail,
+		const string &vsh, const string &fsh, const string &cache = "");
 
 	/**
-	* \brief Destructor. Deletes the vertex-, element-list and the normal and seamless map data.
+	* \brief Destructor. Deletes the vertex-, element-list, the normal and seamless map data and all
+	* compiled shader variants.
 	*/
 	~Terrain();
 
 	/**
-	* \brief Calculates the vertex positions of the terrain based on the given noise object.
-	* Also uploads the calculated, highest Y-value of the terrain to the shader program.
+	* \brief Calculates the grid list, which holds the texture coordinate of each vertex. It only
+	* changes with the vertex count.
 	*/
-	void calculateVertices();
+	void calculateGrid();
+
+	/**
+	* \brief Calculates the grid directly into the given memory, e.g. a mapped vertex buffer.
+	*
+	* \param[in] target Memory for (VPR * VPC) texture coordinates.
+	*/
+	void calculateGrid(vec2 *target)const;
+
+	/**
+	* \brief Calculates the height of each vertex based on the given noise object directly into the
+	* given memory, e.g. a mapped vertex buffer, in the current height format. The lowest and the
+	* highest height are reduced in the same pass, which runs in bands of rows on all cores. The memory
+	* is only written, never read. Does not call OpenGL, so it can run on the loader thread. The
+	* calculated, lowest and highest Y-value need to be uploaded with "uploadSurface()" afterwards.
+	*
+	* Mapped memory can't be read back, so consumers that read the heights on the CPU (the height
+	* texture, the adaptive triangulation) need them to be kept. Then every height is written to the
+	* terrain's own memory as well, see "getHeights()", otherwise that memory is freed.
+	*
+	* \param[in] target Memory for (VPR * VPC) heights of "getHeightSize()" bytes, or nullptr if
+	* the heights are only kept.
+	*
+	* \param[in] keep Whether the heights are kept by the terrain.
+	*/
+	void calculateHeights(void *target, bool keep = false);
+
+	/**
+	* \brief Uploads the size and resolution of the surface, the vertex source and the lowest and the
+	* highest Y-value of the terrain to the shader program. The vertex shader derives the positions
+	* from them and shifts all heights by the lowest value. Needs to be called when the new heights
+	* are exchanged. The terrain's shader program needs to be in use.
+	*/
+	void uploadSurface();
 
 	/**
 	* \brief Calculates the indices of the vertices for drawing with triangle strip, 
-	* based on the vertex count.
+	* based on the vertex count and the element order.
 	*/
 	void calculateElements();
 
 	/**
-	* \brief Calculates the normal map data which is used as a texture. As said this is because
-	* of performance issues.
+	* \brief Calculates the indices directly into the given memory, e.g. a mapped element buffer.
+	*
+	* \param[in] target Memory for "getElementCount()" indices.
+	*/
+	void calculateElements(GLuint *target)const;
+
+	/**
+	* \brief Calculates an adaptive triangulation of the given heights as a right-triangulated irregular
+	* network (RTIN). Each chunk of (ChunkSize x ChunkSize) cells is split recursively along the
+	* hypotenuses of its right triangles as long as the height error of the split vertex is greater
+	* than the maximum error, so flat areas get far less triangles than rugged ones. The chunks are
+	* triangulated in parallel. Edges shared by two chunks are always fully split, so that no cracks
+	* appear between them. Does not call OpenGL, so it can run on the loader thread.
+	*
+	* \param[in] heights (VPR * VPC) heights in the current height format, as written by "calculateHeights()".
+	*
+	* \param[out] target Indices of the triangles, which are drawn in triangle mode.
+	*/
+	void calculateAdaptiveElements(const void *heights, vector<GLuint> &target)const;
+
+	/**
+	* \brief Calculates the normal map band by band, so that only (NormalBandRows) rows of normals are
+	* in memory at a time, and hands every band over as soon as it is done, e.g. for an upload with
+	* glTexSubImage2D. Every band starts at a multiple of 4 rows, the last one takes up to 3 more rows
+	* to reach the bottom of the map. Does not call OpenGL itself.
+	*
+	* \param[in] upload Function that gets the first row of the band, the number of rows and the
+	* normals of the band, row by row and packed into the normal format. With Rgtc2 these are the
+	* compressed blocks of the band.
+	*
+	* \param[in] heights Heights of the vertex grid as kept by "calculateHeights()", see "getHeights()",
+	* or nullptr. Pixels that lie on a vertex take its height instead of evaluating the noise again.
 	*/
-    void calculateNormalMap();
+	void streamNormalMap(const function<void(unsigned, unsigned, const void*)> &upload,
+		const void *heights = nullptr)const;
+
+	/**
+	* \brief Calculates the normals of the given rows of the normal map. The noise values and the
+	* normals are calculated in one pass per tile, on all cores.
+	*
+	* \param[in] z0 First row of the band.
+	*
+	* \param[in] z1 Row behind the last row of the band.
+	*
+	* \param[out] target Memory for the ((z1 - z0) * normal map width) normals of the band.
+	*
+	* \param[in] heights Heights of the vertex grid in the height format, or nullptr.
+	*/
+	void calculateNormalBand(unsigned z0, unsigned z1, vec3 *target, const void *heights = nullptr)const;
+
+	/**
+	* \brief Packs normals into the normal format, as they are uploaded to a texture. Not for Rgtc2,
+	* see "compressNormals()".
+	*
+	* \param[in] normals Normals to pack.
+	*
+	* \param[in] count Number of normals.
+	*
+	* \param[out] target Memory for (count * getNormalSize()) bytes.
+	*/
+	void packNormals(const vec3 *normals, unsigned count, void *target)const;
+
+	/**
+	* \brief Compresses normals to GL_COMPRESSED_SIGNED_RG_RGTC2 blocks of x and z. The rows of
+	* blocks are compressed on all cores. The edges are repeated to fill incomplete blocks.
+	*
+	* \param[in] normals Normals to compress, row by row.
+	*
+	* \param[in] width Number of normals in width.
+	*
+	* \param[in] height Number of normals in height.
+	*
+	* \param[out] target Memory for Texture::compressedSize(..) bytes.
+	*/
+	static void compressNormals(const vec3 *normals, unsigned width, unsigned height, GLubyte *target);
+
+	/**
+	* \brief Compresses one channel of a 4x4 block to a signed RGTC1 block of 8 bytes. The end points
+	* are the minimum and the maximum of the block, all values are snapped to the nearest of the 8
+	* interpolated values in between.
+	*
+	* \param[in] values The 16 values of the block, row by row, in the range [-127, 127].
+	*
+	* \param[out] block The 8 bytes of the block.
+	*/
+	static void compressChannel(const float *values, GLubyte *block);
+
+	/**
+	* \brief Compresses normals with (levelCount - 1) mipmaps to GL_COMPRESSED_SIGNED_RG_RGTC2. Every
+	* mipmap is the normalized mean of 2x2 normals of the level above.
+	*
+	* \param[in] normals Normals of level 0, row by row.
+	*
+	* \param[in] width Number of normals in width.
+	*
+	* \param[in] height Number of normals in height.
+	*
+	* \param[in] levelCount Number of levels including level 0.
+	*
+	* \param[out] levels Compressed data of every level.
+	*/
+	static void compressNormalMipmaps(const vector<vec3> &normals, unsigned width, unsigned height, unsigned levelCount,
+		vector<vector<GLubyte>> &levels);
 
 	/**
 	* \brief Calculates the seamless noise texture data based on the given noise object and
-	* resolution.
+	* resolution. The noise values and the normals are calculated tile by tile on all cores. The
+	* normals wrap around the borders, like the texture does.
 	*
 	* \param[in] n Reference of the noise object which is used for the seamless texture generation.
 	*
@@ -88,6 +272,57 @@ public:
 	*/
 	void calculateSeamlessMap(const Noise &n, unsigned resolution);
 
+	/**
+	* \brief Calculates the normal of every value of the given heightfield, as the average of the
+	* normals of the four triangles around it. The heightfield is worked on tile by tile, on all cores.
+	*
+	* \param[in] heights Heights the normals are calculated for.
+	*
+	* \param[in] scaleX Distance between two values in width.
+	*
+	* \param[in] scaleZ Distance between two values in height.
+	*
+	* \param[out] target Memory for (width * height) normals, which are stored row by row.
+	*
+	* \param[in] wrap Whether the heightfield repeats, so that the neighbours of the border values
+	* are taken from the opposite border. Otherwise they have no neighbour in that direction.
+	*/
+	static void calculateNormals(const Heightfield &heights, float scaleX, float scaleZ, vec3 *target, bool wrap = false);
+
+	/**
+	* \brief Calculates the normal of a height as the average of the normals of the four triangles
+	* around it.
+	*
+	* \param[in] current The height the normal is calculated for.
+	*
+	* \param[in] left, bottom, right, top Pointer to the neighbouring heights, or nullptr when the
+	* height lies on the border and has no neighbour in that direction.
+	*
+	* \param[in] scaleX Distance between two heights in width.
+	*
+	* \param[in] scaleZ Distance between two heights in depth.
+	*/
+	static vec3 calculateNormal(float current, const float *left, const float *bottom, const float *right, const float *top,
+		float scaleX, float scaleZ);
+
+	/**
+	* \brief Splits an area into tiles and runs the given work for every tile. The tiles are
+	* distributed over the threads of the worker pool, the function returns when all tiles are done.
+	*
+	* \param[in] width Width of the area.
+	*
+	* \param[in] height Height of the area.
+	*
+	* \param[in] tileWidth Width of one tile.
+	*
+	* \param[in] tileHeight Height of one tile.
+	*
+	* \param[in] work Function that gets the first position and the position behind the last one of
+	* a tile, in the order (x0, y0, x1, y1). It is called on several threads at the same time.
+	*/
+	static void forEachTile(unsigned width, unsigned height, unsigned tileWidth, unsigned tileHeight,
+		const function<void(unsigned, unsigned, unsigned, unsigned)> &work);
+
 	/**
 	* \brief Applies a texture to terrain by linking the texture id with a sampler in the shader 
 	* program for the terrain.
@@ -96,23 +331,96 @@ public:
 	*
 	* \param[in] texId Id of the texture.
 	*/
-	void applyTexture(const char* samplerName, GLint texId)const;
+	void applyTexture(const char* samplerName, GLint texId);
 
 	/**
-	* \brief Draw the terrain in triangle strip mode with the use of the element list.
+	* \brief Draw the terrain in triangle strip mode with the use of the element list. With the
+	* vertex source HeightTexture the strip is drawn without elements, the rows are connected
+	* by degenerate triangles instead of the primitive restart index. An adaptive triangulation
+	* is drawn in triangle mode. The vertex source HeightTexture draws the elements given to
+	* "adoptElements()" for the adaptive triangulation and the element order Blocks.
+	*
+	* \param[in] elementCount Number of elements in the currently bound element buffer. It is
+	* taken from the buffer, because the element list can already be recalculated for the next
+	* upload while the old one is still drawn. Ignored for the vertex source HeightTexture,
+	* which draws the vertex count of the last "uploadSurface()" call or the adopted elements.
 	*/
-	void draw()const;
+	void draw(unsigned elementCount)const;
 
 	/**
-	* \brief Getter for a Reference of the vertex data.
+	* \brief Replaces the element buffer object that is drawn with the vertex source HeightTexture,
+	* see "getPulledIndexed()". The old element buffer object is deleted.
+	*
+	* \param[in] eboId The new element buffer object, e.g. created by the loader thread.
+	*
+	* \param[in] elementCount Number of elements in the new element buffer object.
 	*/
-	const vector<Vertex>& getVertices()const { return *m_vertices; }
+	void adoptElements(GLuint eboId, unsigned elementCount);
+
+	/**
+	* \brief Getter for a Reference of the grid data.
+	*/
+	const vector<vec2>& getGrid()const { return *m_grid; }
 
 	/**
 	* \brief Getter for a Reference of the element data.
 	*/
 	const vector<GLuint>& getElements()const { return *m_elements; }
 
+	/**
+	* \brief Returns the number of indices needed to draw the current vertex grid in the current
+	* element order, including the primitive restart index after each row.
+	*/
+	unsigned getElementCount()const {
+		if (m_elementOrder == ElementOrder::Blocks)
+			return ((m_vpr - 1) / BlockSize) * (m_vpc - 1) * (2 * (BlockSize + 1) + 1);
+		return (m_vpc - 1) * (2 * m_vpr + 1);
+	}
+
+	/**
+	* \brief Simulates a FIFO post-transform vertex cache for the given elements and returns the
+	* average cache miss ratio (ACMR), i.e. the number of vertex shader invocations per triangle.
+	* 0.5 is the optimum for a grid, 3 means that no vertex is reused at all.
+	*
+	* \param[in] elements Indices of the vertices. Primitive restart indices end a strip.
+	*
+	* \param[in] count Number of indices.
+	*
+	* \param[in] mode GL_TRIANGLE_STRIP or GL_TRIANGLES.
+	*
+	* \param[in] cacheSize Number of vertices in the simulated cache.
+	*/
+	static float calculateACMR(const GLuint *elements, unsigned count, GLenum mode, unsigned cacheSize = 32);
+
+	/**
+	* \brief Returns the number of vertices needed to draw the current vertex grid without
+	* elements. Each row but the last is followed by two degenerate vertices.
+	*/
+	unsigned getPulledVertexCount()const { return (m_vpc - 1) * (2 * m_vpr + 2) - 2; }
+
+	/**
+	* \brief Getter for the maximum height error of the adaptive triangulation. 0 means that the
+	* full grid is drawn.
+	*/
+	float getMaxError()const { return m_maxError; }
+
+	/**
+	* \brief Getter for the boolean that tells whether the currently drawn terrain uses an adaptive
+	* triangulation. Set by "uploadSurface()".
+	*/
+	bool getAdaptiveDrawn()const { return m_adaptiveDrawn; }
+
+	/**
+	* \brief Getter for the order of the triangle strips of the full grid.
+	*/
+	ElementOrder getElementOrder()const { return m_elementOrder; }
+
+	/**
+	* \brief Returns whether the vertex source HeightTexture draws with elements, which is the case
+	* for the adaptive triangulation and the element order Blocks.
+	*/
+	bool getPulledIndexed()const { return m_maxError > 0.0f || m_elementOrder == ElementOrder::Blocks; }
+
 	/**
 	* \brief Getter for the width of the surface.
 	*/
@@ -139,6 +447,11 @@ public:
 	*/
 	bool getSeamlessTexEnabled()const { return m_seamlessTexEnabled; }
 
+	/**
+	* \brief Getter for the boolean that tells whether the stone detail texture is shown.
+	*/
+	bool getStoneDetailEnabled()const { return m_stoneDetailEnabled; }
+
 	/**
 	* \brief Getter for the vertex detail.
 	*/
@@ -155,9 +468,64 @@ public:
 	unsigned getVPR()const { return m_vpr; }
 
 	/**
-	* \brief Getter for the shader program id of the terrain
+	* \brief Getter for the format of the height stream.
+	*/
+	HeightFormat getHeightFormat()const { return m_heightFormat; }
+
+	/**
+	* \brief Getter for the size of one height in the height stream in bytes.
 	*/
-	const GLuint getProgramId()const { return m_programId; }
+	unsigned getHeightSize()const { return m_heightFormat == HeightFormat::Unorm16 ? sizeof(GLushort) : sizeof(GLfloat); }
+
+	/**
+	* \brief Getter for the (VPR * VPC) heights of the last call to "calculateHeights()" in the height format,
+	* or nullptr if they were not kept. The memory is reused by the next call that keeps the heights, as
+	* long as the vertex count and the format stay the same.
+	*/
+	const void* getHeights()const { return m_heights->empty() ? nullptr : m_heights->data(); }
+
+	/**
+	* \brief Getter for the OpenGL type of one height in the height stream.
+	*/
+	GLenum getHeightType()const { return m_heightFormat == HeightFormat::Unorm16 ? GL_UNSIGNED_SHORT : GL_FLOAT; }
+
+	/**
+	* \brief Getter for the format of the normal map and the seamless map.
+	*/
+	NormalFormat getNormalFormat()const { return m_normalFormat; }
+
+	/**
+	* \brief Getter for the size of one packed normal in bytes. Block compressed formats need
+	* Texture::compressedSize(..) instead.
+	*/
+	unsigned getNormalSize()const;
+
+	/**
+	* \brief Getter for the compressed OpenGL format of the normals, or GL_NONE if they are not
+	* block compressed.
+	*/
+	GLenum getNormalCompression()const { return m_normalFormat == NormalFormat::Rgtc2 ? GL_COMPRESSED_SIGNED_RG_RGTC2 : GL_NONE; }
+
+	/**
+	* \brief Getter for the OpenGL pixel format of the packed normals. GL_RGB or GL_RG.
+	*/
+	GLenum getNormalPixelFormat()const { return m_normalFormat == NormalFormat::Float ? GL_RGB : GL_RG; }
+
+	/**
+	* \brief Getter for the OpenGL type of one component of the packed normals.
+	*/
+	GLenum getNormalType()const;
+
+	/**
+	* \brief Getter for the way the vertex shader gets the vertices.
+	*/
+	VertexSource getVertexSource()const { return m_vertexSource; }
+
+	/**
+	* \brief Getter for the shader program id of the terrain, which is the variant for the current
+	* state. It changes with the seamless texture, the stone detail and the normal format.
+	*/
+	GLuint getProgramId()const { return m_variants[m_variant]->getId(); }
 
 	/**
 	* \brief Getter for normal map detail.
@@ -165,12 +533,12 @@ public:
 	unsigned getNormalMapDetail()const { return m_normalMapDetail; }
 
 	/**
-	* \brief Getter for the width of the normalmap which should always equal 256*normalMapDetail.
+	* \brief Getter for the width of the normalmap which should always equal 256*normalMapDetail + 1.
 	*/
 	unsigned getNormalMapWidth()const { return m_normalMapWidth; }
 
 	/**
-	* \brief Getter for the height of the normalmap which should always equal 256*normalMapDetail.
+	* \brief Getter for the height of the normalmap which should always equal 256*normalMapDetail + 1.
 	*/
 	unsigned getNormalMapHeight()const { return m_normalMapHeight; }
 
@@ -179,15 +547,6 @@ public:
 	*/
 	Noise& getNoise() { return *m_noise; }
 
-	/**
-	* \brief Returns a reference to the normal map. The normal map is always being calculated new
-	* because the only case when you can use the old normal map is when all parameters are the same
-	* as before. Then the terrain should not be generated because the result is the same.
-	*
-	* \param[in] detail Detail of the normalMap. Pixel count in width and height is always 256*detail.
-	*/
-	const vector<vec3>& getNormalMap(unsigned detail);
-
 	/**
 	* \brief Returns a reference to the seamless texture data which is calculated based on the given
 	* noise object and the given resolution.
@@ -199,18 +558,11 @@ public:
 	const vector<vec3>& getSeamlessMap(const Noise &n, unsigned resolution);
 
 	/**
-	* \brief Frees the allocated memory for the normal map. This is done by switching the current 
-	* vector with a new empty vector. Was implemented because after the texture
-	* is uploaded the data is no longer needed.
-	*/
-	void freeNormalMap() { m_normalMap->clear(); vector<vec3> s; m_normalMap->swap(s); }
-
-	/**
-	* \brief Frees the allocated memory for the vertex and element list. This is done by switching 
+	* \brief Frees the allocated memory for the grid and element list. This is done by switching 
 	* the current vector with a new empty vector. Was implemented because after the data 
 	* is uploaded to the buffer object, it is no longer needed.
 	*/
-	void freeVertices() { m_vertices->clear(); vector<Vertex> sV; m_vertices->swap(sV); 
+	void freeVertices() { m_grid->clear(); vector<vec2> sG; m_grid->swap(sG); 
 						  m_elements->clear(); vector<GLuint> sE; m_elements->swap(sE); }
 
 	/**
@@ -249,16 +601,76 @@ public:
 	/**
 	* \brief Resets the number of vertices per row and per column.
 	*
-	* \param[in] detail Determines the number of vertices per row and column with 128*detail.
+	* \param[in] detail Determines the number of vertices per row and column with 128*detail + 1.
+	* The grid always consists of a whole number of chunks for the adaptive triangulation.
 	*/
-	void setVertexDetail(unsigned detail) { m_vertexDetail = detail;  m_vpr = 128*detail; m_vpc = 128*detail; }
+	void setVertexDetail(unsigned detail) { m_vertexDetail = detail;  m_vpr = 128*detail + 1; m_vpc = 128*detail + 1; }
 
 	/**
 	* \brief Resets the detail of the normal map.
 	*
-	* \param[in] detail Determines the number of pixel in width and height with 256*detail.
+	* \param[in] detail Determines the number of pixel in width and height with 256*detail + 1.
+	*/
+	void setNormalMapDetail(unsigned detail) { m_normalMapDetail = detail; m_normalMapWidth = 256 * detail + 1; m_normalMapHeight = 256 * detail + 1; }
+
+	/**
+	* \brief Sets the format of the height stream. Needs to be set before the buffer for the height
+	* stream is created, because the vertex attribute depends on it.
+	*
+	* \param[in] format New height format.
+	*/
+	void setHeightFormat(HeightFormat format) { m_heightFormat = format; }
+
+	/**
+	* \brief Sets the format of the normal map and the seamless map and uses the shader variant with
+	* the matching decoding. Needs to be set before the textures are created.
+	*
+	* \param[in] format New normal format.
+	*/
+	void setNormalFormat(NormalFormat format);
+
+	/**
+	* \brief Sets the way the vertex shader gets the vertices. For HeightTexture an empty vertex
+	* array object is created, because drawing without one is not allowed in a core profile.
+	* The source is uploaded with the next "uploadSurface()" call.
+	*
+	* \param[in] source New vertex source.
+	*/
+	void setVertexSource(VertexSource source);
+
+	/**
+	* \brief Sets the maximum height error of the adaptive triangulation in world units. Takes effect
+	* with the next generated terrain.
+	*
+	* \param[in] maxError New maximum error. 0 disables the adaptive triangulation.
+	*/
+	void setMaxError(float maxError) { m_maxError = maxError; }
+
+	/**
+	* \brief Number of cells in width and depth of one chunk of the adaptive triangulation. Needs to
+	* be a power of two that divides 128.
+	*/
+	static const unsigned ChunkSize = 64;
+
+	/**
+	* \brief Sets the order of the triangle strips of the full grid and recalculates the element
+	* list, if there is one.
+	*
+	* \param[in] order New element order.
+	*/
+	void setElementOrder(ElementOrder order);
+
+	/**
+	* \brief Number of cells in width of one stripe of the element order Blocks. The vertices of a
+	* strip, 2*(BlockSize+1), need to fit into the post-transform vertex cache, otherwise no vertex
+	* is reused. Needs to be a power of two that divides 128.
 	*/
-	void setNormalMapDetail(unsigned detail) { m_normalMapDetail = detail; m_normalMapWidth = 256 * detail; m_normalMapHeight = 256 * detail; }
+	static const unsigned BlockSize = 8;
+
+	/**
+	* \brief Number of rows of one band of "streamNormalMap()".
+	*/
+	static const unsigned NormalBandRows = 32;
 
 	/**
 	* \brief Setter for the brightness of the terrain. Also uploads it to the shader program
@@ -269,13 +681,59 @@ public:
 
 	/**
 	* \brief Setter for the boolean that tells whether the seamless texture is shown or hidden.
-	* Alos uploads that value to the shader program.
+	* Uses the shader variant that samples the seamless texture only if it is shown.
 	*
 	* \param[in] enabled New bool value.
 	*/
 	void setSeamlessTexEnabled(bool enabled);
 
+	/**
+	* \brief Setter for the boolean that tells whether the stone detail texture is shown, e.g. as soon
+	* as it was loaded. Uses the shader variant that samples the stone detail texture only if it is shown.
+	*
+	* \param[in] enabled New bool value.
+	*/
+	void setStoneDetailEnabled(bool enabled);
+
 private:
+	/**
+	* \brief Value of a uniform that was set for the terrain. It is set again for every variant
+	* the terrain changes to.
+	*/
+	struct Uniform {
+		bool integer;
+		GLint count;
+		GLfloat f[2];
+		GLint i[2];
+	};
+
+	/**
+	* \brief Number of shader variants. Bit 0 stands for the seamless detail, bit 1 for the stone
+	* detail and bits 2 and 3 for the normal encoding.
+	*/
+	static const unsigned VariantCount = 16;
+
+	/**
+	* \brief Uses the shader variant that matches the seamless texture, the stone detail and the normal
+	* format. It is compiled when it is needed the first time and gets all uniforms that were set before.
+	* Afterwards the variant is in use.
+	*/
+	void selectVariant();
+
+	/**
+	* \brief Sets a uniform of the current variant and remembers it for the other variants. The current
+	* variant needs to be in use.
+	*/
+	void setUniform(const string &name, GLfloat x);
+	void setUniform(const string &name, GLfloat x, GLfloat y);
+	void setUniform(const string &name, GLint x);
+	void setUniform(const string &name, GLint x, GLint y);
+
+	/**
+	* \brief Uploads a remembered uniform to the current variant.
+	*/
+	void uploadUniform(const string &name, const Uniform &uniform)const;
+
 	/**
 	* \brief Width of the surface
 	*/
@@ -287,12 +745,12 @@ private:
 	float m_surfaceDepth;
 
 	/**
-	* \brief Lowest point of the terrain. Should be 0 after recalculation.
+	* \brief Lowest point of the terrain. Subtracted from every height in the vertex shader.
 	*/
 	float m_min;
 
 	/**
-	* \brief Hight point of the terrain. Should be (max-min) after recalculation.
+	* \brief Hight point of the terrain. Is (max-min) after the shift in the vertex shader.
 	*/
 	float m_max;
 
@@ -306,6 +764,11 @@ private:
 	*/
 	bool m_seamlessTexEnabled;
 
+	/**
+	* \brief Boolean that tells whether the stone detail texture is shown.
+	*/
+	bool m_stoneDetailEnabled;
+
 	/**
 	* \brief Detail of the vertex map.
 	*/
@@ -322,9 +785,24 @@ private:
 	unsigned m_vpc;
 
 	/**
-	* \brief Stores the id of the shader program for the terrain
+	* \brief Paths to the shaders and to the program binary cache of the terrain.
+	*/
+	string m_vsh, m_fsh, m_cache;
+
+	/**
+	* \brief Compiled shader variants, null if a variant was not needed yet.
 	*/
-	const GLuint m_programId;
+	Shader *m_variants[VariantCount];
+
+	/**
+	* \brief Number of the variant in use.
+	*/
+	unsigned m_variant;
+
+	/**
+	* \brief All uniforms that were set, by their names.
+	*/
+	map<string, Uniform> m_uniforms;
 
 	/**
 	* \brief Detail of the normal map.
@@ -342,19 +820,72 @@ private:
 	unsigned m_normalMapHeight;
 
 	/**
-	* \brief Number of elements in the index list for the vertices.
+	* \brief Pointer to the given noise object.
 	*/
-	unsigned m_elementsSize;
+    Noise* m_noise;
 
 	/**
-	* \brief Pointer to the given noise object.
+	* \brief Format of the height stream.
 	*/
-    Noise* m_noise;
+	HeightFormat m_heightFormat;
+
+	/**
+	* \brief Format of the normal map and the seamless map.
+	*/
+	NormalFormat m_normalFormat;
+
+	/**
+	* \brief Way the vertex shader gets the vertices.
+	*/
+	VertexSource m_vertexSource;
+
+	/**
+	* \brief Empty vertex array object that is bound when drawing with the vertex source HeightTexture.
+	*/
+	GLuint m_vaoId;
+
+	/**
+	* \brief Number of vertices drawn with the vertex source HeightTexture. Set by "uploadSurface()",
+	* together with the grid resolution in the shader program.
+	*/
+	unsigned m_pulledVertexCount;
+
+	/**
+	* \brief Maximum height error of the adaptive triangulation.
+	*/
+	float m_maxError;
+
+	/**
+	* \brief Boolean that tells whether the currently drawn terrain uses an adaptive triangulation.
+	*/
+	bool m_adaptiveDrawn;
+
+	/**
+	* \brief Order of the triangle strips of the full grid.
+	*/
+	ElementOrder m_elementOrder;
+
+	/**
+	* \brief Boolean that tells whether the currently drawn terrain of the vertex source HeightTexture
+	* uses the adopted elements. Set by "uploadSurface()".
+	*/
+	bool m_pulledIndexedDrawn;
+
+	/**
+	* \brief Element buffer object for the vertex source HeightTexture. It is bound to the empty
+	* vertex array object.
+	*/
+	GLuint m_eboId;
+
+	/**
+	* \brief Number of elements in the element buffer object of the vertex source HeightTexture.
+	*/
+	unsigned m_pulledElementCount;
 
 	/**
-	* \brief List of all vertices.
+	* \brief List of the texture coordinates of all vertices.
 	*/
-	vector<Vertex>* m_vertices;
+	vector<vec2>* m_grid;
 
 	/**
 	* \brief Element list for the vertices.
@@ -362,9 +893,9 @@ private:
 	vector<GLuint>* m_elements;
 
 	/**
-	* \brief Normal map data.
+	* \brief Heights of the vertices in the height format, if they were kept. See "getHeights()".
 	*/
-	vector<vec3> *m_normalMap;
+	vector<GLubyte> *m_heights;
 
 	/**
 	* \brief Seamless texture data.
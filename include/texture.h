@@ -1,27 +1,77 @@
 #pragma once
 
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <climits>
+#include <memory>
+
 #include "noise.h"
 #include "shader.h"
+#include "glstate.h"
 #include "terrain.h"
 #include "window.h"
 #include "glm.h"
+#include "mappedfile.h"
+
+/**
+* \brief Texture image that was decoded on the CPU, but not uploaded yet. It can be prepared on any
+* thread, the upload with constructor "Texture(const TextureImage&, ..)" needs the OpenGL context.
+*/
+struct TextureImage {
+	/**
+	* \brief Pixel count in width and height of level 0.
+	*/
+	unsigned width = 0, height = 0;
+
+	/**
+	* \brief Format, type and internal format of the levels. The type is GL_NONE for compressed levels.
+	*/
+	GLenum format = GL_NONE, type = GL_NONE, internalFormat = GL_NONE;
+
+	/**
+	* \brief Alignment of the rows of uncompressed levels, for GL_UNPACK_ALIGNMENT.
+	*/
+	GLint alignment = 4;
+
+	/**
+	* \brief Data and size in bytes of every level. Points into "pixels" or into "file".
+	*/
+	vector<const GLubyte*> levels;
+	vector<GLuint> sizes;
+
+	/**
+	* \brief Decoded pixels of a '.bmp' file.
+	*/
+	vector<GLubyte> pixels;
+
+	/**
+	* \brief Mapping of a '.ktx' container, whose levels are uploaded straight from it.
+	*/
+	shared_ptr<MappedFile> file;
+};
 
 /**
 * \brief The Texture class.
 *
 * Implements the functunality to upload texture images to OpenGL. It is possible
 * to load a texture directly from a file or from the pixel data itself. Currently 
-* it is only possible to load '.bmp' files. The generated texture needs to be applied 
-* to a sampler in a shader program afterwards. If you want to reduce memory consumption 
-* disable mipmapping or lower the number of generated mipmaps.
+* it is only possible to load '.bmp' files and '.ktx' containers. The generated texture needs
+* to be applied to a sampler in a shader program afterwards. If you want to reduce memory
+* consumption disable mipmapping or lower the number of generated mipmaps.
+*
+* The '.ktx' containers (KTX 1.1) hold all mipmaps already, optionally S3TC compressed. They
+* are mapped into memory and uploaded level by level, without decoding and without generating
+* mipmaps. They are created from '.bmp' files with "convertToContainer()".
 */
 class Texture
 {
 public:
 	/**
-	* \brief Constructor that generates a texture from a '.bmp' file. 
+	* \brief Constructor that generates a texture from a '.bmp' file or a '.ktx' container.
 	*
-	* \param[in] file Char array for the file's name.
+	* \param[in] file Char array for the file's name. Files ending on '.ktx' are read as container.
 	*
 	* \param[in] wrapper Defines how the texture is repeated when drawn multiple times.
 	* Can be (for example) one  GL_MIRRORED_REPEAT or GL_REPEAT. For a detailed desciption 
@@ -40,27 +90,78 @@ public:
 	/**
 	* \brief Constructor that generates a texture from a '.bmp' file.
 	*
-	* \param[in] data Pointer to the pixel data of the texture.
+	* \param[in] data Pointer to the pixel data of the texture. If it is nullptr, the texture is
+	* only allocated and its data needs to be uploaded with "sub()" or "subRows()" afterwards.
 	*
 	* \param[in] texWidth Number of color values in width.
 	*
 	* \param[in] texHeight Number of color values in height.
 	*
 	* \param[in] format Format that determines how the values are read from the given data
-	* Pointer. Could be for example GL_RGB or GL_RGBA for textures with alpha value.
+	* Pointer. Could be for example GL_RGB or GL_RGBA for textures with alpha value, GL_RED
+	* for single channel textures like height maps or GL_RG for packed normals.
 	*
 	* \param[in] wrapper See desciption of constructor 1.
 	*
 	* \param[in] filter See descrittion of constructor 1.
 	*
 	* \param[in] texUnit Unit of the texture, used for the glActiveTexture method.
+	*
+	* \param[in] type Type of one color element. GL_FLOAT, or GL_UNSIGNED_SHORT for a 16 bit
+	* normalized single channel texture or GL_UNSIGNED_BYTE for an 8 bit one. For GL_RG, GL_SHORT makes a GL_RG16_SNORM and
+	* GL_UNSIGNED_BYTE a GL_RG8 texture. For GL_RGBA, GL_UNSIGNED_BYTE makes a GL_RGBA8 texture.
 	*/
-	Texture(const void* data, unsigned texWidth, unsigned texHeight, GLenum format, GLint wrapper, GLint filter, GLuint texUnit);
+	Texture(const void* data, unsigned texWidth, unsigned texHeight, GLenum format, GLint wrapper, GLint filter, GLuint texUnit,
+		GLenum type = GL_FLOAT);
+
+	/**
+	* \brief Constructor that generates a texture from block compressed data, one entry per mipmap
+	* level. Level i is the size of level 0 halved i times. The mipmaps are not generated by OpenGL,
+	* because block compressed textures cannot be rendered to.
+	*
+	* \param[in] levels Pointers to the compressed data of the levels. A nullptr only allocates the
+	* level, its data needs to be uploaded with "subCompressedRows()" afterwards.
+	*
+	* \param[in] texWidth Number of color values in width of level 0.
+	*
+	* \param[in] texHeight Number of color values in height of level 0.
+	*
+	* \param[in] internalFormat Compressed format of the data, e.g. GL_COMPRESSED_SIGNED_RG_RGTC2.
+	*
+	* \param[in] wrapper See desciption of constructor 1.
+	*
+	* \param[in] filter See descrittion of constructor 1.
+	*
+	* \param[in] texUnit Unit of the texture, used for the glActiveTexture method.
+	*/
+	Texture(const vector<const void*> &levels, unsigned texWidth, unsigned texHeight, GLenum internalFormat,
+		GLint wrapper, GLint filter, GLuint texUnit);
+
+	/**
+	* \brief Constructor that uploads an image that was decoded with "decode()" before.
+	*
+	* \param[in] image The decoded image.
+	*
+	* \param[in] wrapper See desciption of constructor 1.
+	*
+	* \param[in] filter See descrittion of constructor 1.
+	*
+	* \param[in] texUnit Unit of the texture, used for the glActiveTexture method.
+	*/
+	Texture(const TextureImage &image, GLint wrapper, GLint filter, GLuint texUnit);
+
+	/**
+	* \brief Constructor for an empty texture without any OpenGL texture object. Used as a placeholder
+	* that gets its texture later on through "swap()", e.g. when the texture is created by the loader thread.
+	*
+	* \param[in] texUnit Unit of the texture, used for the glActiveTexture method.
+	*/
+	Texture(GLuint texUnit);
 
 	/**
 	* \brief Deletes the texture.
 	*/
-	~Texture() { glDeleteTextures(1, &id); }
+	~Texture() { GLState::deleteTextures(1, &id); }
 
 	/**
 	* \brief Uploads new texture data to the already created OpenGL texture. Need to call  
@@ -82,8 +183,117 @@ public:
 	void sub(const void* data, GLenum format, GLenum type, unsigned texWidth, unsigned texHeight);
 
 	/**
-	* \brief Uses the texture by setting the active texture unit with glActiveTexture and then bind
-	* the texture id to GL_TEXTURE_2D. Need to be called when another texture unit was used before.
+	* \brief Uploads new texture data for some rows of the already created OpenGL texture, e.g.
+	* while the rest of the texture is still being calculated.
+	*
+	* \param[in] data Pointer to the pixel data of the rows.
+	*
+	* \param[in] format Format that determines how the values are read from the given data
+	* Pointer. Could be for example GL_RGB or GL_RGBA for textures with alpha value.
+	*
+	* \param[in] type Type of one color element. Could be GL_FLOAT.
+	*
+	* \param[in] y First row that is overwritten.
+	*
+	* \param[in] rows Number of rows.
+	*/
+	void subRows(const void* data, GLenum format, GLenum type, unsigned y, unsigned rows);
+
+	/**
+	* \brief Uploads new texture data for a rectangle of the already created OpenGL texture, e.g.
+	* for one area of an atlas.
+	*
+	* \param[in] data Pointer to the pixel data of the rectangle.
+	*
+	* \param[in] format Format that determines how the values are read from the given data
+	* Pointer. Could be for example GL_RGB or GL_RGBA for textures with alpha value.
+	*
+	* \param[in] type Type of one color element. Could be GL_FLOAT.
+	*
+	* \param[in] x Left column of the rectangle.
+	*
+	* \param[in] y Bottom row of the rectangle.
+	*
+	* \param[in] width Width of the rectangle.
+	*
+	* \param[in] height Height of the rectangle.
+	*/
+	void subRect(const void* data, GLenum format, GLenum type, unsigned x, unsigned y, unsigned width, unsigned height);
+
+	/**
+	* \brief Same as "subRows()" for block compressed textures.
+	*
+	* \param[in] data Pointer to the compressed blocks of the rows.
+	*
+	* \param[in] internalFormat Compressed format the texture was created with.
+	*
+	* \param[in] y First row that is overwritten. Needs to be a multiple of 4.
+	*
+	* \param[in] rows Number of rows. Needs to be a multiple of 4, unless the rows end at the
+	* bottom of the texture.
+	*/
+	void subCompressedRows(const void* data, GLenum internalFormat, unsigned y, unsigned rows);
+
+	/**
+	* \brief Returns the size of block compressed data in bytes. Only the RGTC formats and S3TC DXT1
+	* are supported.
+	*
+	* \param[in] internalFormat Compressed format.
+	*
+	* \param[in] width Number of color values in width.
+	*
+	* \param[in] height Number of color values in height.
+	*/
+	static GLsizei compressedSize(GLenum internalFormat, unsigned width, unsigned height);
+
+	/**
+	* \brief Converts a '.bmp' file to a '.ktx' container with all mipmaps, which are the mean of
+	* 2x2 pixels of the level above. Runs without OpenGL, e.g. as an offline step.
+	*
+	* \param[in] bmp Path to the '.bmp' file.
+	*
+	* \param[in] ktx Path to the container that is written.
+	*
+	* \param[in] compress Whether the levels are compressed to GL_COMPRESSED_RGB_S3TC_DXT1_EXT.
+	* Otherwise they are stored as GL_RGB8.
+	*
+	* \return Whether the container was written.
+	*/
+	static bool convertToContainer(const char* bmp, const char* ktx, bool compress);
+
+	/**
+	* \brief Returns the path of the '.ktx' container next to the given '.bmp' file, if it exists,
+	* otherwise the path of the '.bmp' file.
+	*
+	* \param[in] bmp Path to the '.bmp' file.
+	*/
+	static string preferContainer(const string &bmp);
+
+	/**
+	* \brief Decodes a '.bmp' file or maps a '.ktx' container and reads all of its pages. Does not
+	* call OpenGL, so it can run on any thread, while the upload runs later on. An S3TC compressed
+	* container is replaced by the '.bmp' file of the same name, if the driver does not support S3TC.
+	*
+	* \param[in] file Path to the file.
+	*
+	* \param[out] image The decoded image.
+	*
+	* \return Whether the image was decoded.
+	*/
+	static bool decode(const string &file, TextureImage &image);
+
+	/**
+	* \brief Exchanges the OpenGL texture object and its size with the given texture. The texture
+	* units stay untouched. The old texture object is deleted together with the other texture.
+	*
+	* \param[in] other Texture to exchange the texture object with.
+	*/
+	void swap(Texture &other);
+
+	/**
+	* \brief Uses the texture by binding the texture id to GL_TEXTURE_2D of its texture unit. Nothing
+	* is called if the texture is still bound to the unit. The active texture unit is not necessarily
+	* changed.
 	*/
 	void use();
 
@@ -102,8 +312,45 @@ public:
 	*/
 	GLuint getUnit()const { return m_unit; }
 
+	/**
+	* \brief Getter for the pixel count in width.
+	*/
+	unsigned getWidth()const { return m_texWidth; }
+
+	/**
+	* \brief Getter for the pixel count in height.
+	*/
+	unsigned getHeight()const { return m_texHeight; }
+
 
 private:
+	/**
+	* \brief Binds the texture to its texture unit and makes the unit active, so that the texture
+	* can be modified.
+	*/
+	void bind();
+
+	/**
+	* \brief Creates the texture object from a decoded image and uploads all of its levels.
+	*
+	* \param[in] image The decoded image.
+	*
+	* \param[in] wrapper See desciption of constructor 1.
+	*
+	* \param[in] filter See descrittion of constructor 1.
+	*/
+	void upload(const TextureImage &image, GLint wrapper, GLint filter);
+
+	/**
+	* \brief Compresses a block of 4x4 RGB pixels to S3TC DXT1. The end points are the corners of the
+	* bounding box of the block's colors along the main diagonal of their distribution.
+	*
+	* \param[in] rgb The 16 pixels of the block, row by row, 3 bytes each.
+	*
+	* \param[out] block The 8 bytes of the block.
+	*/
+	static void compressBlockDXT1(const GLubyte *rgb, GLubyte *block);
+
 	/**
 	* \brief Pixel count in width.
 	*/
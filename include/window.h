@@ -3,10 +3,12 @@
 #include <iostream>
 #include <cstdlib>
 #include <chrono>
+#include <vector>
 #include <SDL.h>
 #include <GL/glew.h>
 #include <SDL_opengl.h>
 #include "error.h"
+#include "glstate.h"
 
 /**
 * \brief Enumeration class for the style for which the Window is constructed. Currently
@@ -51,7 +53,7 @@ public:
 
 	/**
 	* \brief Updates the window and handles events like closing the window, resizing it or changing from
-	* flying-mode into cursor-mode by pressing "Space".
+	* flying-mode into cursor-mode by pressing "Space". Mouse events are collected for the gui.
 	*/
 	bool update();
 
@@ -75,22 +77,32 @@ public:
 	*/
 	bool resized()const { return m_windowResized; }
 
+	/**
+	* \brief Getter for the mouse motion and mouse button events since the last update.
+	*/
+	const vector<SDL_Event>& getMouseEvents()const { return m_mouseEvents; }
+
 	/**
 	* \brief Getter for the ratio between width and height.
 	*/
 	float getAspect()const { return m_aspect; }
 
 	/**
-	* \brief Getter for the frames per second. To get the current Fps, "calculateFps()" needs
-	* to be called in somewhere in the main loop.
+	* \brief Creates a second OpenGL context that shares its objects (textures, buffers, programs
+	* and sync objects) with the main context. The main context stays current on the calling thread.
+	* The returned context can then be made current on another thread with "makeCurrent()".
+	*
+	* \return The shared context or null if it could not be created.
 	*/
-	int getFps()const { return m_fps; }
+	SDL_GLContext createSharedContext();
 
 	/**
-	* \brief Calculates the current frames per second. Needs to be called somewhere in the main loop
-	* to update the member variable m_fps.
+	* \brief Makes the given context current on the calling thread. Passing null releases the
+	* current context of the calling thread.
+	*
+	* \param[in] context Context created by this window.
 	*/
-	void calculateFPS();
+	void makeCurrent(SDL_GLContext context)const;
 
 private:
 	/**
@@ -103,11 +115,6 @@ private:
 	*/
 	SDL_GLContext m_glc;
 
-	/**
-	* \brief Frames per second.
-	*/
-	int m_fps;
-
 	/**
 	* \brief Window width.
 	*/
@@ -132,6 +139,11 @@ private:
 	* \brief Boolean used for switching between flying-mode and cursor-mode.
 	*/
 	bool m_mouseModeReleased;
+
+	/**
+	* \brief Mouse events since the last update.
+	*/
+	vector<SDL_Event> m_mouseEvents;
 };
 
 const Window* getMainWindow();
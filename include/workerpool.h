@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+using namespace std;
+
+/**
+* \brief The WorkerPool class.
+*
+* One set of threads for the whole application, which the CPU heavy loops (noise passes, normal map
+* bands, compression and triangulation) are distributed over. The threads are started with the first
+* call of "run()" and live until the end of the program, so a loop does not create and join threads
+* every time. Loops that are run by several threads at the same time, e.g. by the loader thread and
+* a worker thread, share the pool instead of starting threads of their own for all cores. Single
+* tasks, like decoding an image, can be posted to the pool without waiting for them.
+*/
+class WorkerPool {
+public:
+	/**
+	* \brief Runs the given work for every index from 0 to count - 1 on the threads of the pool and on
+	* the calling thread. Returns when the work is done for all indices.
+	*
+	* \param[in] count Number of indices.
+	*
+	* \param[in] work Function that gets the index. It is called on several threads at the same time.
+	*/
+	static void run(unsigned count, const function<void(unsigned)> &work);
+
+	/**
+	* \brief Runs the given task on a thread of the pool and returns right away. The tasks are started
+	* in the order they were posted, as soon as a thread is free. Without any threads in the pool the
+	* task runs on the calling thread.
+	*
+	* \param[in] task Function that runs on a thread of the pool. It may call "run()" itself.
+	*/
+	static void post(function<void()> task);
+
+	/**
+	* \brief Stops and joins the threads of the pool.
+	*/
+	~WorkerPool();
+
+private:
+	/**
+	* \brief The indices of one call of "run()", or a single posted task, which is kept in "posted".
+	* Threads take the next index until all are taken.
+	*/
+	struct Batch {
+		const function<void(unsigned)> *work;
+		function<void(unsigned)> posted;
+		unsigned count;
+		atomic<unsigned> next, done;
+		mutex finishedMutex;
+		condition_variable finished;
+	};
+
+	/**
+	* \brief Starts one thread less than there are cores, because the calling thread works as well.
+	*/
+	WorkerPool();
+
+	/**
+	* \brief Returns the pool, which is created with the first call.
+	*/
+	static WorkerPool& instance();
+
+	/**
+	* \brief Runs the work for the next indices of a batch until all are taken.
+	*/
+	static void work(Batch &batch);
+
+	/**
+	* \brief Loop of the threads of the pool. Takes the oldest batch that still has indices left.
+	*/
+	void loop();
+
+	/**
+	* \brief Threads of the pool.
+	*/
+	vector<thread> m_threads;
+
+	/**
+	* \brief Batches that still have or had indices left. Finished batches are removed by their caller,
+	* posted ones by the thread that ran them.
+	*/
+	deque<shared_ptr<Batch>> m_batches;
+
+	/**
+	* \brief Mutex for the batch queue.
+	*/
+	mutex m_mutex;
+
+	/**
+	* \brief Wakes up the threads when a batch was added or they shall stop.
+	*/
+	condition_variable m_wake;
+
+	/**
+	* \brief Boolean that tells the threads to stop.
+	*/
+	bool m_stop;
+};
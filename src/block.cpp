@@ -6,20 +6,9 @@
 Shader* guiShader = nullptr;
 
 /**
-* \brief Location id for the 'useTexture' uniform in the gui shader program. Tells
-* whether a texture for this block is used or not.
+* \brief Batch that collects and draws the quads of all blocks.
 */
-GLuint useTexLoc;
-
-/**
-* \brief Location id for color uniform in the gui shader program.
-*/
-GLuint colorLoc;
-
-/**
-* \brief Location id for the brightness uniform in the gui shader program.
-*/
-GLuint brightnessLoc;
+GuiBatch* guiBatch = nullptr;
 
 /**
 * \brief Width and Height of the main window. Used to let the button size the same after window resize.
@@ -27,27 +16,25 @@ GLuint brightnessLoc;
 float startWidth, startHeight;
 
 /**
-* \brief Deletes the shader program.
+* \brief Deletes the gui batch and the shader program.
 */
 void quit() {
+	delete guiBatch;
 	delete guiShader;
 }
 
 /**
-* \brief Initializes the shader program and stores the width and height of the SDL window.
-* Also gets the location of all uniforms in the gui shader program and stores them into
-* the global defines variables.
+* \brief Initializes the shader program and the gui batch and stores the width and height
+* of the SDL window.
 */
 void init() {
 	checkGLError("'block.cpp' init() -> Error occured before this call");
 
-	guiShader = new Shader{ "shader/gui.vsh", "shader/gui.fsh" };
+	guiShader = new Shader{ "shader/gui.vsh", "shader/gui.fsh", "shader/gui.cache" };
 	startWidth = float(getMainWindow()->getWidth()); 
 	startHeight = float(getMainWindow()->getHeight());
 
-	useTexLoc = glGetUniformLocation(guiShader->getId(), "useTexture");
-	colorLoc = glGetUniformLocation(guiShader->getId(), "color");
-	brightnessLoc = glGetUniformLocation(guiShader->getId(), "brightness");
+	guiBatch = new GuiBatch(guiShader, 4, 5);
 
 	atexit(quit);
 
@@ -58,16 +45,10 @@ Block::Block(int x, int y, unsigned w, unsigned h) : m_x(x), m_y(y), m_width(w),
 	if (x < 0 || y < 0)
 		printCriticalError("Block(x, y, w, h)", "x or y must not be less than 0");
 	else {
-		// Init texture with null
-		m_tex = nullptr;
-
-		// Initialize the shader program once after program start
+		// Initialize the shader program and the batch once after program start
 		if (!guiShader)
 			init();
 
-		// Use the block shader program
-		guiShader->use();
-
 		// Initialize text content
 		m_textcontent = L"";
 
@@ -75,13 +56,7 @@ Block::Block(int x, int y, unsigned w, unsigned h) : m_x(x), m_y(y), m_width(w),
 		m_edges[0] = vec2((float(m_x) / startWidth), (float(m_y) / startHeight));
 		m_edges[1] = vec2((float(m_x + w) / startWidth), (float(m_y + h) / startHeight));
 
-		// Create buffer object with 8 float values (4 vertices with x and y)
-		m_vbuf = new Buffer<vec2>(4, GL_STATIC_DRAW);
-
-		// Tell the buffer how the vertex data should be read
-		m_vbuf->attrib(guiShader->getId(), "position", 2, 1, 0);
-
-		// Calculate the 4 corners of the block and transform their position to OpenGL coordinates (from -1.0 to 1.0).
+		// Calculate the 2 corners of the block and transform their position to OpenGL coordinates (from -1.0 to 1.0).
 		calculateVertices();
 
 		// Setting default color
@@ -94,20 +69,46 @@ void Block::calculateVertices(){
 	float scaleX = startWidth / getMainWindow()->getWidth();
 	float scaleY = startHeight / getMainWindow()->getHeight();
 
-    // Array for the vertex data
-	vector<vec2> vertexData;
+    // Calculate the corners and transform them to OpenGL coordinates, the batch makes the 4 vertices
+	m_corners[0] = vec2((m_edges[0].x * scaleX)*2.0f - 1.0f, -(m_edges[0].y * scaleY)*2.0f + 1.0f);
+	m_corners[1] = vec2((m_edges[1].x * scaleX)*2.0f - 1.0f, -(m_edges[1].y * scaleY)*2.0f + 1.0f);
+
+	// Same for the glyphs, whose edges are relative to the top left corner of the block
+	m_glyphCorners.resize(m_glyphRects.size() * 2);
+	for (size_t i = 0; i < m_glyphRects.size(); i++) {
+		const vec4 &r = m_glyphRects[i];
+		float left = m_edges[0].x + r.x / startWidth, top = m_edges[0].y + r.y / startHeight;
+		float right = m_edges[0].x + r.z / startWidth, bottom = m_edges[0].y + r.w / startHeight;
+		m_glyphCorners[i * 2] = vec2((left * scaleX)*2.0f - 1.0f, -(top * scaleY)*2.0f + 1.0f);
+		m_glyphCorners[i * 2 + 1] = vec2((right * scaleX)*2.0f - 1.0f, -(bottom * scaleY)*2.0f + 1.0f);
+	}
+}
+
+void Block::draw(float brightness){
+	// Calculate new corners when window was resized
+	if (getMainWindow()->resized())
+		calculateVertices();
 
-	// Reserve 8 float values (4 vertices with x and y)
-	vertexData.reserve(4);
+	// Background with the block's color, then the glyphs in white on top of it
+	guiBatch->add(m_corners, guiBatch->getWhite(), vec4(m_rgba[0], m_rgba[1], m_rgba[2], m_rgba[3]) * brightness);
+	for (size_t i = 0; i < m_glyphTexCoords.size(); i++)
+		guiBatch->add(&m_glyphCorners[i * 2], m_glyphTexCoords[i], vec4(brightness));
+}
 
-    // Calculate the vertex data and transform it to OpenGL coordinates
-	vertexData.push_back(vec2((m_edges[0].x * scaleX)*2.0f - 1.0f, -(m_edges[0].y * scaleY)*2.0f + 1.0f));
-	vertexData.push_back(vec2((m_edges[0].x * scaleX)*2.0f - 1.0f, -(m_edges[1].y * scaleY)*2.0f + 1.0f));
-	vertexData.push_back(vec2((m_edges[1].x * scaleX)*2.0f - 1.0f, -(m_edges[0].y * scaleY)*2.0f + 1.0f));
-	vertexData.push_back(vec2((m_edges[1].x * scaleX)*2.0f - 1.0f, -(m_edges[1].y * scaleY)*2.0f + 1.0f));
+void Block::placeText(Text &text, int xOff, int yOff){
+	m_glyphRects.clear();
+	m_glyphTexCoords.clear();
+	for (const Text::Quad &q : text.getQuads()) {
+		// Quads are placed from the bottom, the rectangles from the top of the block
+		int left = xOff + q.x;
+		int bottom = int(m_height) - (yOff + q.y);
+		m_glyphRects.push_back(vec4(float(left), float(bottom - int(q.glyph->height)), float(left + int(q.glyph->width)), float(bottom)));
+		m_glyphTexCoords.push_back(q.glyph->texCoords);
+	}
+	calculateVertices();
 
-    // Upload the vertex data to the buffer object
-	m_vbuf->upload(vertexData);
+	// The gui is drawn again with the new text
+	guiBatch->invalidate();
 }
 
 void Block::color(float r, float g, float b, float a){
@@ -119,12 +120,14 @@ void Block::color(float r, float g, float b, float a){
 	m_rgba[1] = g;
 	m_rgba[2] = b;
 	m_rgba[3] = a;
+	guiBatch->invalidate();
 }
 
 void Block::reorder(int posX, int posY) {
 	m_edges[0] = vec2((float(posX) / startWidth), (float(posY) / startHeight));
 	m_edges[1] = vec2((float(posX + m_width) / startWidth), (float(posY + m_height) / startHeight));
 	calculateVertices();
+	guiBatch->invalidate();
 }
 
 void Block::text(wstring str, Font& ft) {
@@ -135,70 +138,24 @@ void Block::text(wstring str, Font& ft) {
 		// Copy string into member variable
 		m_textcontent = str;
 
-		// Create text object
-		Text text(str, ft);
+		// Lay out the text with the cached glyphs
+		Text text(str, ft, *guiBatch);
 
 		// Check if the text fits into the block
 		if (text.getWidth() > m_width)
 			printError("Block::text(..)", "String does not fit into the block. No text created");
 		else {
-			// Allocate memory for the texture pixel-data
-			vector<float> textureData;
-			textureData.reserve(m_width*m_height * 4);
-
-			// Fill texture pixel data with background color
-			for (unsigned i = 0; i < m_width*m_height; i++)
-				for (unsigned j = 0; j < 4; j++)
-					textureData.push_back(m_rgba[j]);
-
 			// Calculate offset to center the text within the block
 			int x_off = int(((m_width - text.getWidth()) / 2.0f));
 			int y_off = int(((m_height - text.getHeight()) / 2.0f))-1;
 
-			// Write the pixel data of the text into the pixel data of the texture
-			// Only write if the text fits into the block
-			if (text.getWidth() <= m_width) {
-				for (unsigned y = 0; y < text.getHeight(); y++) {
-					for (unsigned x = 0; x < text.getWidth(); x++) {
-
-						// p is the grey scale color of one pixel of the antialised text
-						unsigned char p = text.getPixmap()[x + y*text.getWidth()];
-
-						// If the grey color of the pixel is not pure black
-						if (p > 0) {
-							float textColor = float(p) / 255.0f;
-
-							// Then write the the pixel data into the texture data
-							for (int i = 0; i < 4; ++i)
-
-								// Consider that, the darker a pixel is the more transparent it will be.
-								// Then overwrite the background color pixel-data.
-								textureData[((x + x_off) + (y + y_off)*m_width) * 4 + i] += m_rgba[i] + (1.0f - m_rgba[i])*textColor;
-						}
-					}
-				}
-			}
-
-			// If texture already exists, overwrite the texture data
-			if (m_tex)
-				m_tex->sub(textureData.data(), GL_RGBA, GL_FLOAT, m_width, m_height);
-			else {
-				checkGLError("Block::text(..) -> Error occured before this call");
-				// Otherwise create a new texture
-				m_tex = new Texture(textureData.data(), m_width, m_height, GL_RGBA, GL_NONE, GL_LINEAR, 4);
-				// Attach texture to a unit in the gui shader program
-				glUniform1i(glGetUniformLocation(guiShader->getId(), "tex"), m_tex->getUnit());
-				checkGLError("Block::text(..) -> Attach texture to texture unit in the gui shader");
-			}
+			// Only the positions of the cached glyphs are stored
+			placeText(text, x_off, y_off);
 		}
 	}
 }
 
-Block::~Block(){
-	delete m_vbuf;
-	if (m_tex)
-		delete m_tex;
-}
+Block::~Block(){}
 
 /**
  * \brief Getter for the shader program
@@ -208,23 +165,9 @@ const Shader* getGuiShader(){
 }
 
 /**
-* \brief Getter for the 'useTexture' uniform location id that was set once in the block.cpp file
-*/
-const GLuint getUseTexLoc() {
-	return useTexLoc;
-}
-
-/**
-* \brief Getter for the 'color' uniform location id that was set once in the block.cpp file
-*/
-const GLuint getColorLoc() {
-	return colorLoc;
-}
-
-/**
-* \brief Getter for the 'brightness' uniform location id that was set once in the block.cpp file
+* \brief Getter for the gui batch, which draws all blocks.
 */
-const GLuint getBrightnessLoc() {
-	return brightnessLoc;
+GuiBatch* getGuiBatch() {
+	return guiBatch;
 }
 
@@ -1,14 +1,14 @@
 #include "camera.h"
 
 Camera::Camera(vec3 pos, const GLuint programId)
-	: m_position(pos), m_rotation(vec2(0.0, 0.0)), m_lightRotation(0.0f)
+	: m_position(pos), m_rotation(vec2(0.0, 0.0)), m_lightRotation(0.0f), m_programId(programId)
 {
 	// Get keyboard state
 	m_keyboardState = SDL_GetKeyboardState(NULL);
 
 	// Get name for projection-translation-rotation matrix
-	m_mvpLoc = glGetUniformLocation(programId, "mvp");
-	m_posLoc = glGetUniformLocation(programId, "cameraPos");
+	m_mvpLoc = GLState::getUniformLocation(programId, "mvp");
+	m_posLoc = GLState::getUniformLocation(programId, "cameraPos");
 
 	// Get relative mouse position
 	SDL_GetRelativeMouseState(&m_mousePos.x, &m_mousePos.y);
@@ -30,7 +30,7 @@ Camera::Camera(vec3 pos, const GLuint programId)
 
 	// Upload light direction
 	checkGLError("Camera(..) -> Error occured before this call");
-	m_lightLoc = glGetUniformLocation(programId, "lightDir");
+	m_lightLoc = GLState::getUniformLocation(programId, "lightDir");
 	glUniform3fv(m_lightLoc, 1, value_ptr(-m_lightDir));
 	checkGLError("Camera(..) -> Upload light direction");
 }
@@ -112,3 +112,19 @@ void Camera::update(){
 		glUniform3fv(m_lightLoc, 1, value_ptr(-m_lightDir));
 	}
 }
+
+void Camera::setProgram(GLuint programId){
+	if (programId == m_programId)
+		return;
+	checkGLError("Camera::setProgram(..) -> Error occured before this call");
+	m_programId = programId;
+
+	// The locations differ between programs, the uniforms of the new program are not set yet
+	m_mvpLoc = GLState::getUniformLocation(programId, "mvp");
+	m_posLoc = GLState::getUniformLocation(programId, "cameraPos");
+	m_lightLoc = GLState::getUniformLocation(programId, "lightDir");
+	glUniformMatrix4fv(m_mvpLoc, 1, GL_FALSE, value_ptr(m_mvpMatrix));
+	glUniform3fv(m_posLoc, 1, value_ptr(m_position));
+	glUniform3fv(m_lightLoc, 1, value_ptr(-m_lightDir));
+	checkGLError("Camera::setProgram(..)");
+}
@@ -0,0 +1,140 @@
+#include "dispatcher.h"
+
+Dispatcher::Dispatcher(unsigned cellSize) : m_cellSize(cellSize), m_hovered(NoButton), m_pressed(NoButton) {
+	for (bool &e : m_enabled)
+		e = true;
+}
+
+unsigned Dispatcher::add(Button *button, ButtonGroup group, function<void()> action, bool repeat){
+	if (!button) {
+		printError("Dispatcher::add(..)", "Given button object is null. No button added.");
+		return NoButton;
+	}
+
+	unsigned handle = unsigned(m_entries.size());
+	m_entries.push_back({ button, group, action, repeat });
+
+	// Sort the button into all cells it overlaps
+	int x0 = button->getStartX() / int(m_cellSize), y0 = button->getStartY() / int(m_cellSize);
+	int x1 = (button->getStartX() + int(button->getWidth())) / int(m_cellSize);
+	int y1 = (button->getStartY() + int(button->getHeight())) / int(m_cellSize);
+	for (int cy = y0; cy <= y1; cy++)
+		for (int cx = x0; cx <= x1; cx++)
+			m_cells[cellKey(cx, cy)].push_back(handle);
+	return handle;
+}
+
+void Dispatcher::setEnabled(ButtonGroup group, bool enabled){
+	m_enabled[unsigned(group)] = enabled;
+	if (enabled)
+		return;
+
+	// A disabled button must neither stay highlighted nor be clicked later on
+	if (m_hovered != NoButton && m_entries[m_hovered].group == group) {
+		unsigned old = m_hovered;
+		m_hovered = NoButton;
+		refresh(old);
+	}
+	if (m_pressed != NoButton && m_entries[m_pressed].group == group) {
+		unsigned old = m_pressed;
+		m_pressed = NoButton;
+		refresh(old);
+	}
+}
+
+void Dispatcher::handle(const vector<SDL_Event> &events){
+	for (const SDL_Event &evt : events) {
+		int x, y;
+		if (evt.type == SDL_MOUSEMOTION) {
+			x = evt.motion.x;
+			y = evt.motion.y;
+		}
+		else if ((evt.type == SDL_MOUSEBUTTONDOWN || evt.type == SDL_MOUSEBUTTONUP) && evt.button.button == SDL_BUTTON_LEFT) {
+			x = evt.button.x;
+			y = evt.button.y;
+		}
+		else
+			continue;
+
+		// Only the buttons that changed get a new state
+		unsigned hovered = hit(x, y);
+		if (hovered != m_hovered) {
+			unsigned old = m_hovered;
+			m_hovered = hovered;
+			refresh(old);
+			refresh(m_hovered);
+		}
+
+		if (evt.type == SDL_MOUSEBUTTONDOWN) {
+			m_pressed = m_hovered;
+			refresh(m_pressed);
+		}
+		else if (evt.type == SDL_MOUSEBUTTONUP && m_pressed != NoButton) {
+			// A click needs the button to be released over the button it was pressed on
+			unsigned clicked = m_pressed;
+			m_pressed = NoButton;
+			refresh(clicked);
+			refresh(m_hovered);
+			if (clicked == m_hovered && !m_entries[clicked].repeat && m_entries[clicked].action)
+				m_entries[clicked].action();
+		}
+	}
+}
+
+void Dispatcher::update(){
+	if (m_pressed != NoButton && m_pressed == m_hovered && m_entries[m_pressed].repeat && m_entries[m_pressed].action)
+		m_entries[m_pressed].action();
+}
+
+void Dispatcher::reset(){
+	unsigned hovered = m_hovered, pressed = m_pressed;
+	m_hovered = m_pressed = NoButton;
+	refresh(hovered);
+	refresh(pressed);
+}
+
+Button* Dispatcher::getButton(unsigned handle)const{
+	if (handle >= m_entries.size()) {
+		printError("Dispatcher::getButton(..)", "Handle " + to_string(handle) + " is not assigned. Null returned.");
+		return nullptr;
+	}
+	return m_entries[handle].button;
+}
+
+unsigned Dispatcher::hit(int x, int y)const{
+	if (x < 0 || y < 0)
+		return NoButton;
+	auto cell = m_cells.find(cellKey(x / int(m_cellSize), y / int(m_cellSize)));
+	if (cell == m_cells.end())
+		return NoButton;
+
+	// The button of the latest group is on top, within a group the latest registered one
+	unsigned result = NoButton;
+	for (unsigned handle : cell->second) {
+		const Entry &e = m_entries[handle];
+		const Button *b = e.button;
+		if (!m_enabled[unsigned(e.group)])
+			continue;
+		if (x > b->getStartX() && y > b->getStartY() && x < b->getStartX() + int(b->getWidth()) && y < b->getStartY() + int(b->getHeight()))
+			if (result == NoButton || e.group >= m_entries[result].group)
+				result = handle;
+	}
+	return result;
+}
+
+void Dispatcher::refresh(unsigned handle){
+	if (handle == NoButton)
+		return;
+
+	// Pressed only while the mouse is over the button, highlighted only while no other button is held
+	StateId state = StateId::None;
+	if (handle == m_hovered)
+		state = handle == m_pressed ? StateId::Pressed : (m_pressed == NoButton ? StateId::Mouseover : StateId::None);
+
+	// Only a changed state needs the gui to be drawn again
+	Button *button = m_entries[handle].button;
+	if (button->getState() != state) {
+		button->setState(state);
+		getGuiBatch()->invalidate();
+	}
+}
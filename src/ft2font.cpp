@@ -45,6 +45,7 @@ Font::Font(string path, FT_UInt size) : m_size(size) {
 	// Error checking
 	if (err)
 		printError("Font::Font(path, size)", "Given font size is not supported");
+	updateMetrics();
 }
 
 void Font::setSize(FT_UInt size) {
@@ -54,60 +55,72 @@ void Font::setSize(FT_UInt size) {
 	// Error checking
 	if (err)
 		printError("Font::setSize(size)", "Given font size is not supported");
-	else
+	else {
 		m_size = size;
+		updateMetrics();
+	}
 }
 
-Font::~Font() {
-	FT_Done_Face(m_face);
+void Font::updateMetrics() {
+	// Divide by 64 because of the freetype internal size format
+	m_descent = unsigned(-m_face->size->metrics.descender >> 6);
+	m_lineHeight = unsigned((m_face->size->metrics.ascender - m_face->size->metrics.descender) >> 6);
 }
 
-Text::Text(wstring text, Font& font): m_text(text), m_width(0), m_height(0){
-	if (text.empty())
-		printCriticalError("Text::Text(text, font)", "text is empty.");
-	else {
-		// Load text's characters one by one into the freetype face
-		for (auto c : text) {
-			FT_Load_Char(font.getFace(), c, FT_LOAD_ADVANCE_ONLY);
+const Glyph& Font::getGlyph(wchar_t c, GuiBatch &atlas) {
+	unsigned long long key = (unsigned long long)(m_size) << 32 | unsigned(c);
+	auto cached = m_glyphs.find(key);
+	if (cached != m_glyphs.end())
+		return cached->second;
 
-			// Calculate the text's width
-			m_width += font.getFace()->glyph->advance.x;
+	// Render the glyph once
+	Glyph glyph = { 0, 0, 0, 0, 0, vec4(0.0f) };
+	if (FT_Load_Char(m_face, c, FT_LOAD_RENDER))
+		printError("Font::getGlyph(..)", "Character could not be rendered.");
+	else {
+		FT_GlyphSlot slot = m_face->glyph;
+		glyph.left = slot->bitmap_left;
+		glyph.top = slot->bitmap_top;
+		glyph.width = slot->bitmap.width;
+		glyph.height = slot->bitmap.rows;
+		glyph.advance = int(slot->advance.x >> 6);
+
+		// Store the bitmap in the atlas, bottom row first like all areas of the atlas
+		if (glyph.width > 0 && glyph.height > 0) {
+			if (atlas.allocate(glyph.width, glyph.height, glyph.texCoords)) {
+				vector<unsigned char> pixels(glyph.width * glyph.height);
+				for (unsigned y = 0; y < glyph.height; ++y)
+					memcpy(&pixels[(glyph.height - 1 - y) * glyph.width], slot->bitmap.buffer + y * slot->bitmap.pitch, glyph.width);
+				atlas.store(pixels.data(), glyph.texCoords, glyph.width, glyph.height);
+			}
+			else
+				glyph.width = glyph.height = 0;
 		}
+	}
+	return m_glyphs.insert({ key, glyph }).first->second;
+}
 
-		// Divide width by 64 because of the freetype internal size format.
-		m_width >>= 6;
-
-		// Calculate height and divide by 64
-		m_height = (font.getFace()->size->metrics.ascender - font.getFace()->size->metrics.descender) >> 6;
-
-		// Allocate memory for the pixel data
-		m_pixmap = new unsigned char[m_width*m_height]();
+Font::~Font() {
+	FT_Done_Face(m_face);
+}
 
-		// Starting point of the letter to be drawn next
-		int penX = 0, penY = -font.getFace()->size->metrics.descender >> 6;
+Text::Text(wstring text, Font& font, GuiBatch &atlas): m_text(text), m_width(0), m_height(0){
+	if (text.empty())
+		printCriticalError("Text::Text(text, font, atlas)", "text is empty.");
+	else {
+		// The baseline is above the lowest point of the glyphs
+		m_height = font.getLineHeight();
+		int penX = 0, penY = int(font.getDescent());
 
-		// Load each character into the pixmap
+		// Place each character with its cached glyph
 		for (auto c : text) {
-			// Load single char
-			FT_Load_Char(font.getFace(), c, FT_LOAD_RENDER);
-
-			// Create a freetype glyph slot
-			FT_GlyphSlot glyph = font.getFace()->glyph;
-
-			// Write into the pixmap
-			for (unsigned y = 0; y < glyph->bitmap.rows; ++y) {
-				for (unsigned x = 0; x < glyph->bitmap.width; ++x) {
-					m_pixmap[penX + glyph->bitmap_left + x + (penY + glyph->bitmap_top - y) * m_width]
-						= glyph->bitmap.buffer[x + y * glyph->bitmap.pitch];
-				}
-			}
+			const Glyph &glyph = font.getGlyph(c, atlas);
+			if (glyph.width > 0 && glyph.height > 0)
+				m_quads.push_back({ penX + glyph.left, penY + glyph.top - int(glyph.height) + 1, &glyph });
 
 			// Change starting point for next letter
-			penX += font.getFace()->glyph->advance.x >> 6;
+			penX += glyph.advance;
 		}
+		m_width = unsigned(penX);
 	}
 }
-
-Text::~Text() {
-	delete[] m_pixmap;
-}
@@ -0,0 +1,141 @@
+#include "glstate.h"
+
+thread_local GLState::State GLState::s_state;
+atomic<unsigned> GLState::s_deletions(0);
+
+GLState::State::State() : deletions(0), issued(0), skipped(0) {
+	clear();
+}
+
+void GLState::State::clear(){
+	program = vertexArray = arrayBuffer = activeUnit = Unknown;
+	for (GLuint &t : textures)
+		t = Unknown;
+	elementBuffers.clear();
+}
+
+GLState::State& GLState::current(){
+	// Names of deleted objects may be reused, so no binding of any context can be trusted anymore
+	unsigned deletions = s_deletions.load();
+	if (s_state.deletions != deletions) {
+		s_state.clear();
+		s_state.deletions = deletions;
+	}
+	return s_state;
+}
+
+void GLState::useProgram(GLuint program){
+	State &state = current();
+	if (state.program == program) {
+		state.skipped++;
+		return;
+	}
+	glUseProgram(program);
+	state.program = program;
+	state.issued++;
+}
+
+void GLState::bindVertexArray(GLuint vao){
+	State &state = current();
+	if (state.vertexArray == vao) {
+		state.skipped++;
+		return;
+	}
+	glBindVertexArray(vao);
+	state.vertexArray = vao;
+	state.issued++;
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer){
+	State &state = current();
+	if (target == GL_ARRAY_BUFFER) {
+		if (state.arrayBuffer == buffer) {
+			state.skipped++;
+			return;
+		}
+		state.arrayBuffer = buffer;
+	}
+	else if (target == GL_ELEMENT_ARRAY_BUFFER && state.vertexArray != Unknown) {
+		auto element = state.elementBuffers.find(state.vertexArray);
+		if (element != state.elementBuffers.end() && element->second == buffer) {
+			state.skipped++;
+			return;
+		}
+		state.elementBuffers[state.vertexArray] = buffer;
+	}
+	glBindBuffer(target, buffer);
+	state.issued++;
+}
+
+void GLState::activeTexture(State &state, GLuint unit){
+	if (state.activeUnit == unit)
+		return;
+	glActiveTexture(GL_TEXTURE0 + unit);
+	state.activeUnit = unit;
+	state.issued++;
+}
+
+void GLState::bindTexture(GLuint unit, GLuint texture){
+	State &state = current();
+	if (unit < TrackedUnits && state.textures[unit] == texture) {
+		state.skipped++;
+		return;
+	}
+	activeTexture(state, unit);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (unit < TrackedUnits)
+		state.textures[unit] = texture;
+	state.issued++;
+}
+
+void GLState::selectTexture(GLuint unit, GLuint texture){
+	State &state = current();
+	if (state.activeUnit == unit)
+		state.skipped++;
+	activeTexture(state, unit);
+	bindTexture(unit, texture);
+}
+
+GLint GLState::getUniformLocation(GLuint program, const string &name){
+	// Locations only change when a program is linked again, which the shader class never does
+	unordered_map<string, GLint> &uniforms = s_state.uniforms[program];
+	auto location = uniforms.find(name);
+	if (location != uniforms.end()) {
+		s_state.skipped++;
+		return location->second;
+	}
+	GLint loc = glGetUniformLocation(program, name.c_str());
+	uniforms[name] = loc;
+	s_state.issued++;
+	return loc;
+}
+
+void GLState::deleteProgram(GLuint program){
+	glDeleteProgram(program);
+	s_state.uniforms.erase(program);
+	s_deletions++;
+}
+
+void GLState::deleteVertexArrays(GLsizei n, const GLuint *vaos){
+	glDeleteVertexArrays(n, vaos);
+	s_deletions++;
+}
+
+void GLState::deleteBuffers(GLsizei n, const GLuint *buffers){
+	glDeleteBuffers(n, buffers);
+	s_deletions++;
+}
+
+void GLState::deleteTextures(GLsizei n, const GLuint *textures){
+	glDeleteTextures(n, textures);
+	s_deletions++;
+}
+
+void GLState::invalidate(){
+	s_state.clear();
+}
+
+void GLState::resetCounters(){
+	s_state.issued = 0;
+	s_state.skipped = 0;
+}
@@ -19,7 +19,11 @@ Gui::Gui(Terrain &terrain){
 	// Initialize member
 	m_terrain = &terrain;
 	m_showInfo = true;
+	m_infoTicks = SDL_GetTicks();
+	m_infoFrames = 0;
 	m_showNoisePanel = false;
+	m_seamlessTexReady = true;
+	m_seamlessTexWanted = m_terrain->getSeamlessTexEnabled();
 	m_keyboardState = SDL_GetKeyboardState(NULL);
 
 	// Shorten strings
@@ -35,24 +39,52 @@ Gui::Gui(Terrain &terrain){
 	Label *terrainLabel = new Label(10, 10, 200, 25);
 
 	// Create Information Panel
-	m_infoPanel = new Panel(getMainWindow()->getWidth() -200, 0, 200, 50);
+	m_infoPanel = new Panel(getMainWindow()->getWidth() -200, 0, 200, 235);
 	m_infoPanel->color(0.2f, 0.2f, 0.2f, 0.0f);
 
 	// Create information labels
 	Label *vertexCountLabel = new Label(getMainWindow()->getWidth() - 200, 10, 200, 20);
 	Label *normalMapResLabel = new Label(getMainWindow()->getWidth() - 200, 30, 200, 20);
+	Label *triangleCountLabel = new Label(getMainWindow()->getWidth() - 200, 50, 200, 20);
+	Label *acmrLabel = new Label(getMainWindow()->getWidth() - 200, 70, 200, 20);
+	Label *seamlessLabel = new Label(getMainWindow()->getWidth() - 200, 90, 200, 20);
+	Label *stateLabel = new Label(getMainWindow()->getWidth() - 200, 110, 200, 20);
+	Label *frameLabel = new Label(getMainWindow()->getWidth() - 200, 130, 200, 20);
+	Label *cpuLabel = new Label(getMainWindow()->getWidth() - 200, 150, 200, 20);
+	Label *gpuLabel = new Label(getMainWindow()->getWidth() - 200, 170, 200, 20);
 
 	// Setting color for info labels
 	vertexCountLabel->color(0.2f, 0.2f, 0.2f, 0.0f);
 	normalMapResLabel->color(0.2f, 0.2f, 0.2f, 0.0f);
+	triangleCountLabel->color(0.2f, 0.2f, 0.2f, 0.0f);
+	acmrLabel->color(0.2f, 0.2f, 0.2f, 0.0f);
+	seamlessLabel->color(0.2f, 0.2f, 0.2f, 0.0f);
+	stateLabel->color(0.2f, 0.2f, 0.2f, 0.0f);
+	frameLabel->color(0.2f, 0.2f, 0.2f, 0.0f);
+	cpuLabel->color(0.2f, 0.2f, 0.2f, 0.0f);
+	gpuLabel->color(0.2f, 0.2f, 0.2f, 0.0f);
 
 	// Setting text for info labels
 	vertexCountLabel->text(L"Vertices: " + to_wstring(m_terrain->getVPR()*m_terrain->getVPC()), font);
 	normalMapResLabel->text(L"Normal-Map Pixel: " + to_wstring(m_terrain->getNormalMapWidth()) + L"x" + to_wstring(m_terrain->getNormalMapHeight()), font);
+	triangleCountLabel->text(L"Dreiecke: " + to_wstring(2 * (m_terrain->getVPR() - 1) * (m_terrain->getVPC() - 1)), font);
+	acmrLabel->text(L"ACMR: -", font);
+	seamlessLabel->text(L"Noise Textur: bereit", font);
+	stateLabel->text(L"GL Aufrufe: -", font);
+	frameLabel->text(L"Frame ms: -", font);
+	cpuLabel->text(L"CPU: -", font);
+	gpuLabel->text(L"GPU: -", font);
 	
 	// Add info labels to info panel
 	m_infoPanel->addLabel(vertexCountLabel, "label_VertexCount");
 	m_infoPanel->addLabel(normalMapResLabel, "label_NormalMapResolution");
+	m_infoPanel->addLabel(triangleCountLabel, "label_TriangleCount");
+	m_infoPanel->addLabel(acmrLabel, "label_ACMR");
+	m_infoPanel->addLabel(seamlessLabel, "label_SeamlessTexture");
+	m_infoPanel->addLabel(stateLabel, "label_GLCalls");
+	m_infoPanel->addLabel(frameLabel, "label_FrameTimes");
+	m_infoPanel->addLabel(cpuLabel, "label_CpuTimes");
+	m_infoPanel->addLabel(gpuLabel, "label_GpuTimes");
 
     // Create Main Panel
     m_mainPanel = new Panel(0, 0, 220, 2000);
@@ -178,6 +210,57 @@ Gui::Gui(Terrain &terrain){
 	font.setSize(16);
 	m_loading->text(L"Laden ...", font);
 	font.setSize(12);
+
+	registerButtons();
+}
+
+void Gui::registerButtons(){
+	// The names are only looked up once, afterwards the dispatcher finds the buttons by their position
+	auto main = [this](const string &name) { return m_mainPanel->getButtonAt("button_" + name); };
+	auto noise = [this](const string &name) { return m_noisePanel->getButtonAt("button_" + name); };
+
+	// Always usable while the main panel is shown
+	m_dispatcher.add(main("incBrightness"), ButtonGroup::Main, [this]() { modifyBrightness(0.1f); }, true);
+	m_dispatcher.add(main("decBrightness"), ButtonGroup::Main, [this]() { modifyBrightness(-0.1f); }, true);
+	m_dispatcher.add(main("activateTexture"), ButtonGroup::Main, [this]() { activateTextureClicked(); });
+	m_dispatcher.add(main("openNoisePanel"), ButtonGroup::Main, [this]() {
+		if (m_showNoisePanel)
+			hideNoisePanel();
+		else
+			showNoisePanel();
+	});
+
+	// Terrain modifiers, the surface size and the amplitude change as long as their buttons are held
+	m_dispatcher.add(main("incSurfaceSize"), ButtonGroup::Terrain, [this]() { modifySurfaceSize(1); }, true);
+	m_dispatcher.add(main("decSurfaceSize"), ButtonGroup::Terrain, [this]() { modifySurfaceSize(-1); }, true);
+	m_dispatcher.add(main("incVertexDetail"), ButtonGroup::Terrain, [this]() { modifyVertexDetail(1); });
+	m_dispatcher.add(main("decVertexDetail"), ButtonGroup::Terrain, [this]() { modifyVertexDetail(-1); });
+	m_dispatcher.add(main("incNormalMapDetail"), ButtonGroup::Terrain, [this]() { modifyNormalMapDetail(1); });
+	m_dispatcher.add(main("decNormalMapDetail"), ButtonGroup::Terrain, [this]() { modifyNormalMapDetail(-1); });
+	m_dispatcher.add(main("randomizeSeed"), ButtonGroup::Terrain, [this]() { randomizeSeed(); });
+	m_dispatcher.add(main("defaultSeed"), ButtonGroup::Terrain, [this]() { defaultSeed(); });
+	m_dispatcher.add(main("incSeed"), ButtonGroup::Terrain, [this]() { modifySeed(1); });
+	m_dispatcher.add(main("decSeed"), ButtonGroup::Terrain, [this]() { modifySeed(-1); });
+	m_dispatcher.add(main("incLayerCount"), ButtonGroup::Terrain, [this]() { modifyLayerCount(1); });
+	m_dispatcher.add(main("decLayerCount"), ButtonGroup::Terrain, [this]() { modifyLayerCount(-1); });
+	m_dispatcher.add(main("incStartFrequency"), ButtonGroup::Terrain, [this]() { modifyStartFrequency(1.0f); });
+	m_dispatcher.add(main("decStartFrequency"), ButtonGroup::Terrain, [this]() { modifyStartFrequency(-1.0f); });
+	m_dispatcher.add(main("incFrequencyFactor"), ButtonGroup::Terrain, [this]() { modifyFrequencyFactor(0.05f); });
+	m_dispatcher.add(main("decFrequencyFactor"), ButtonGroup::Terrain, [this]() { modifyFrequencyFactor(-0.05f); });
+	m_dispatcher.add(main("incWeightDivisor"), ButtonGroup::Terrain, [this]() { modifyWeightDivisor(0.05f); });
+	m_dispatcher.add(main("decWeightDivisor"), ButtonGroup::Terrain, [this]() { modifyWeightDivisor(-0.05f); });
+	m_dispatcher.add(main("incAmplitude"), ButtonGroup::Terrain, [this]() { modifyAmplitude(1); }, true);
+	m_dispatcher.add(main("decAmplitude"), ButtonGroup::Terrain, [this]() { modifyAmplitude(-1); }, true);
+	m_generateButton = m_dispatcher.add(main("generate"), ButtonGroup::Terrain, [this]() {
+		if (m_generateAction)
+			m_generateAction();
+	});
+
+	// Noise types, the panel closes after one was chosen
+	m_dispatcher.add(noise("changeToPerlin"), ButtonGroup::Noise, [this]() { hideNoisePanel(); changeToPerlinClicked(); });
+	m_dispatcher.add(noise("changeToBillowy"), ButtonGroup::Noise, [this]() { hideNoisePanel(); changeToBillowyClicked(); });
+	m_dispatcher.add(noise("changeToRidgid"), ButtonGroup::Noise, [this]() { hideNoisePanel(); changeToRidgidClicked(); });
+	m_dispatcher.add(noise("changeToCosinus"), ButtonGroup::Noise, [this]() { hideNoisePanel(); changeToCosinusClicked(); });
 }
 
 Gui::~Gui(){
@@ -187,117 +270,23 @@ Gui::~Gui(){
 	delete m_infoPanel;
 }
 
-void Gui::update(){
-	// Listen "Surface Size" modifier
-    if (m_mainPanel->getButtonAt("button_incSurfaceSize")->getState() == StateId::Pressed)
-        modifySurfaceSize(1);
-    if (m_mainPanel->getButtonAt("button_decSurfaceSize")->getState() == StateId::Pressed)
-		modifySurfaceSize(-1);
-
-	// Listen "Vertex Detail" modifier
-    if (m_mainPanel->getButtonAt("button_incVertexDetail")->getState() == StateId::Released)
-        modifyVertexDetail(1);
-    if (m_mainPanel->getButtonAt("button_decVertexDetail")->getState() == StateId::Released)
-        modifyVertexDetail(-1);
-
-	// Listen "Normal map Resolution" modifier
-    if (m_mainPanel->getButtonAt("button_incNormalMapDetail")->getState() == StateId::Released)
-        modifyNormalMapDetail(1);
-    if (m_mainPanel->getButtonAt("button_decNormalMapDetail")->getState() == StateId::Released)
-        modifyNormalMapDetail(-1);
-
-	// Listen "Seed" modifier
-	if (m_mainPanel->getButtonAt("button_randomizeSeed")->getState() == StateId::Released)
-		randomizeSeed();
-	if (m_mainPanel->getButtonAt("button_defaultSeed")->getState() == StateId::Released)
-		defaultSeed();
-	if (m_mainPanel->getButtonAt("button_incSeed")->getState() == StateId::Released)
-		modifySeed(1);
-	if (m_mainPanel->getButtonAt("button_decSeed")->getState() == StateId::Released)
-		modifySeed(-1);
-
-	// Listen "Layer count" modifier
-    if (m_mainPanel->getButtonAt("button_incLayerCount")->getState() == StateId::Released)
-        modifyLayerCount(1);
-    if (m_mainPanel->getButtonAt("button_decLayerCount")->getState() == StateId::Released)
-        modifyLayerCount(-1);
-
-	// Listen "Start Frequency" modifier
-    if (m_mainPanel->getButtonAt("button_incStartFrequency")->getState() == StateId::Released)
-        modifyStartFrequency(1.0f);
-    if (m_mainPanel->getButtonAt("button_decStartFrequency")->getState() == StateId::Released)
-        modifyStartFrequency(-1.0f);
-
-	// Listen "Frequency Factor" modifier
-	if (m_mainPanel->getButtonAt("button_incFrequencyFactor")->getState() == StateId::Released)
-		modifyFrequencyFactor(0.05f);
-	if (m_mainPanel->getButtonAt("button_decFrequencyFactor")->getState() == StateId::Released)
-		modifyFrequencyFactor(-0.05f);
-
-	// Listen "Weight Divisor" modifier
-	if (m_mainPanel->getButtonAt("button_incWeightDivisor")->getState() == StateId::Released)
-		modifyWeightDivisor(0.05f);
-	if (m_mainPanel->getButtonAt("button_decWeightDivisor")->getState() == StateId::Released)
-		modifyWeightDivisor(-0.05f);
-
-	// Listen "Amplitude" modifier
-	if (m_mainPanel->getButtonAt("button_incAmplitude")->getState() == StateId::Pressed)
-		modifyAmplitude(1);
-	if (m_mainPanel->getButtonAt("button_decAmplitude")->getState() == StateId::Pressed)
-		modifyAmplitude(-1);
-}
-
-void Gui::updateBrightness() {
-	// Listen "Terrain Brightness" modifier
-	if (m_mainPanel->getButtonAt("button_incBrightness")->getState() == StateId::Pressed)
-		modifyBrightness(0.1f);
-	if (m_mainPanel->getButtonAt("button_decBrightness")->getState() == StateId::Pressed)
-		modifyBrightness(-0.1f);
-	
-}
-void Gui::updateTextureEnabling(){
-	// Listen if seamless noise texture shall be activated or deactivated
-	if (m_mainPanel->getButtonAt("button_activateTexture")->getState() == StateId::Released)
-		activateTextureClicked();
-}
-void Gui::updateNoisePanelEvents() {
-	static bool changeHit = false;
-
-	// Listen "Noise Type" modifiers
-	if (!changeHit) {
-		if (m_noisePanel->getButtonAt("button_changeToPerlin")->getState() == StateId::Released) {
-			hideNoisePanel();
-			changeHit = true;
-			changeToPerlinClicked();
-		}
-		if (m_noisePanel->getButtonAt("button_changeToBillowy")->getState() == StateId::Released) {
-			hideNoisePanel();
-			changeHit = true;
-			changeToBillowyClicked();
-		}
-		if (m_noisePanel->getButtonAt("button_changeToRidgid")->getState() == StateId::Released) {
-			hideNoisePanel();
-			changeHit = true;
-			changeToRidgidClicked();
-		}
-		if (m_noisePanel->getButtonAt("button_changeToCosinus")->getState() == StateId::Released) {
-			hideNoisePanel();
-			changeHit = true;
-			changeToCosinusClicked();
-		}
+void Gui::update(const vector<SDL_Event> &events, bool active, bool editable){
+	// Without the cursor the buttons can neither be hovered nor clicked
+	if (!active) {
+		m_dispatcher.reset();
+		return;
 	}
 
-	// Listen whether the noise panel should be open or hidden
-	if (m_mainPanel->getButtonAt("button_openNoisePanel")->getState() == StateId::Released) {
-		if (!m_showNoisePanel) {
-			changeHit = false;
-			showNoisePanel();
-		}
-		else
-			hideNoisePanel();
-	}
+	// The noise panel covers the terrain modifiers, which are also locked while the terrain is generated
+	m_dispatcher.setEnabled(ButtonGroup::Terrain, editable && !m_showNoisePanel);
+	m_dispatcher.setEnabled(ButtonGroup::Noise, m_showNoisePanel);
+
+	// Only the events and a held button cause work
+	m_dispatcher.handle(events);
+	m_dispatcher.update();
 }
-void Gui::updateInfo() {
+
+void Gui::updateInfo(const Profiler &profiler) {
 	static bool keyPressed = false;
 	
 	// Hide/Show information panel when i was pressed
@@ -312,6 +301,53 @@ void Gui::updateInfo() {
 	}
 	else
 		keyPressed = false;
+
+	// Calls and skipped calls per frame. Only updated once per second, so the gui is not drawn again every frame.
+	m_infoFrames++;
+	Uint32 ticks = SDL_GetTicks();
+	if (ticks - m_infoTicks >= 1000) {
+		m_infoPanel->getLabelAt("label_GLCalls")->text(L"GL Aufrufe: " + to_wstring(GLState::getIssued() / m_infoFrames) +
+			L", gespart: " + to_wstring(GLState::getSkipped() / m_infoFrames), font);
+		GLState::resetCounters();
+
+		// Frame times of the history and average times of the phases and passes in milliseconds
+		float minTime, avgTime, p99Time;
+		profiler.getFrameTimes(minTime, avgTime, p99Time);
+		m_infoPanel->getLabelAt("label_FrameTimes")->text(L"Frame ms: " + to_wstring(minTime).substr(0, 4) + L"/" +
+			to_wstring(avgTime).substr(0, 4) + L"/" + to_wstring(p99Time).substr(0, 4), font);
+		wstring cpuText = L"CPU:";
+		for (unsigned i = 0; i < unsigned(Phase::Count); i++)
+			cpuText += L" " + to_wstring(profiler.getCpuTime(Phase(i))).substr(0, 4);
+		m_infoPanel->getLabelAt("label_CpuTimes")->text(cpuText, font);
+		wstring gpuText = L"GPU:";
+		for (unsigned i = 0; i < unsigned(Pass::Count); i++) {
+			float gpuTime = profiler.getGpuTime(Pass(i));
+			gpuText += gpuTime < 0.0f ? L" -" : L" " + to_wstring(gpuTime).substr(0, 4);
+		}
+		m_infoPanel->getLabelAt("label_GpuTimes")->text(gpuText, font);
+		m_frameGraph = profiler.getHistory();
+
+		m_infoTicks = ticks;
+		m_infoFrames = 0;
+	}
+}
+
+void Gui::updateFrameGraph() {
+	// Graph of the frame times below the labels, one bar of 2 pixels per frame. The bars are
+	// red above 16.7 ms (60 FPS) and reach the top at 33.3 ms.
+	if (m_showInfo) {
+		float width = float(getMainWindow()->getWidth()), height = float(getMainWindow()->getHeight());
+		float left = width - 2.0f * m_frameGraph.size(), bottom = 230.0f;
+		for (unsigned i = 0; i < m_frameGraph.size(); i++) {
+			float top = bottom - 40.0f * std::min(m_frameGraph[i] / 33.3f, 1.0f);
+			vec2 corners[2] = {
+				vec2((left + 2.0f * i) * 2.0f / width - 1.0f, 1.0f - top * 2.0f / height),
+				vec2((left + 2.0f * (i + 1)) * 2.0f / width - 1.0f, 1.0f - bottom * 2.0f / height)
+			};
+			vec4 color = m_frameGraph[i] > 16.7f ? vec4(0.8f, 0.2f, 0.2f, 0.8f) : vec4(0.2f, 0.8f, 0.2f, 0.8f);
+			getGuiBatch()->add(corners, getGuiBatch()->getWhite(), color);
+		}
+	}
 }
 
 void Gui::layout_modifier(wstring labelText, string modifierName, vec2 startpoint, int w, int h, int bW){
@@ -344,41 +380,197 @@ void Gui::layout_modifier(wstring labelText, string modifierName, vec2 startpoin
 	}
 }
 
-void Gui::generateTerrain(Texture &normalTexture, Buffer<Vertex> &terrainBuffer){
+void Gui::generateTerrain(Texture &normalTexture, Texture &heightTexture, Buffer<vec2> *terrainBuffer, Loader &loader){
 	checkGLError("Gui::generateTerrain(..) -> Error occurred before this call");
 
-	// Use terrain shader program 
-	glUseProgram(m_terrain->getProgramId());
+	// Objects created by the loader thread, that are handed over to the render thread
+	struct Staged { Texture *normalTexture, *heightTexture; GLuint heights, grid, ebo; unsigned vertexCount, elementCount; float acmr; };
+	shared_ptr<Staged> staged = make_shared<Staged>();
+
+	// Only calculate new grid and element list when the vertex count differ. An adaptive triangulation
+	// needs new elements every time, and so does the switch back from it to the full grid. Vertex
+	// pulling only needs elements for the element order Blocks, which are calculated every time.
+	bool pulling = m_terrain->getVertexSource() == VertexSource::HeightTexture;
+	bool adaptive = m_terrain->getMaxError() > 0.0f;
+	bool newGrid = !pulling && m_terrain->getVPR()*m_terrain->getVPC() != terrainBuffer->getVertexCount();
+	bool newStrip = !adaptive && (pulling ? m_terrain->getPulledIndexed() : newGrid || m_terrain->getAdaptiveDrawn());
+	Terrain *terrain = m_terrain;
+	GLuint heightUnit = heightTexture.getUnit();
+
+	loader.submit([staged, terrain, pulling, adaptive, newGrid, newStrip, heightUnit]() {
+		staged->vertexCount = terrain->getVPR()*terrain->getVPC();
+		staged->heightTexture = nullptr;
+		staged->heights = 0;
+		staged->grid = 0;
+		staged->ebo = 0;
+		staged->elementCount = 0;
+		staged->acmr = -1.0f;
+
+		// The terrain keeps the heights for the height texture and the adaptive triangulation. The
+		// normal map shares the samples that lie on the vertex grid only when they were kept, they
+		// are not worth a copy of their own.
+		if (pulling) {
+			// Vertex pulling only needs the heights as a single channel texture
+			terrain->calculateHeights(nullptr, true);
+			staged->heightTexture = new Texture(terrain->getHeights(), terrain->getVPR(), terrain->getVPC(),
+				GL_RED, GL_CLAMP_TO_EDGE, GL_NEAREST, heightUnit, terrain->getHeightType());
+			checkGLError("Gui::generateTerrain(..) -> Upload new height texture");
+		}
+		else {
+			// Calculate the new heights into a mapped buffer object. The old buffer object stays
+			// untouched until it is exchanged, so the mapping never waits for the current frame.
+			GLsizeiptr heightSize = staged->vertexCount*terrain->getHeightSize();
+			staged->heights = Buffer<vec2>::createStorage(GL_ARRAY_BUFFER, heightSize, nullptr, GL_DYNAMIC_DRAW);
+			do {
+				void *target = Buffer<vec2>::mapStorage(GL_ARRAY_BUFFER, staged->heights, heightSize);
+				if (!target)
+					printCriticalError("Gui::generateTerrain(..)", "Height buffer could not be mapped.");
+				terrain->calculateHeights(target, adaptive);
+			} while (!Buffer<vec2>::unmapStorage(GL_ARRAY_BUFFER, staged->heights));
+		}
+
+		// Same for the static grid, but only when the vertex count differs
+		if (newGrid) {
+			GLsizeiptr gridSize = staged->vertexCount*sizeof(vec2);
+			staged->grid = Buffer<vec2>::createStorage(GL_ARRAY_BUFFER, gridSize, nullptr, GL_STATIC_DRAW);
+			do {
+				vec2 *grid = (vec2*)Buffer<vec2>::mapStorage(GL_ARRAY_BUFFER, staged->grid, gridSize);
+				if (!grid)
+					printCriticalError("Gui::generateTerrain(..)", "Grid buffer could not be mapped.");
+				terrain->calculateGrid(grid);
+			} while (!Buffer<vec2>::unmapStorage(GL_ARRAY_BUFFER, staged->grid));
+		}
 
-	// Calculate new vertices and elements
-    m_terrain->calculateVertices();
-	checkGLError("Gui::generateTerrain(..) -> Calculate new vertex data");
+		// The elements are kept in memory, so that their vertex cache efficiency can be reported
+		vector<GLuint> elements;
+		GLenum mode = GL_TRIANGLE_STRIP;
+		if (adaptive) {
+			// Adaptive triangulation of the heights. Its size is only known afterwards.
+			terrain->calculateAdaptiveElements(terrain->getHeights(), elements);
+			mode = GL_TRIANGLES;
+		}
+		else if (newStrip) {
+			elements.resize(terrain->getElementCount());
+			terrain->calculateElements(elements.data());
+		}
+		if (!elements.empty()) {
+			staged->acmr = Terrain::calculateACMR(elements.data(), elements.size(), mode);
+			staged->elementCount = elements.size();
+			staged->ebo = Buffer<vec2>::createStorage(GL_ELEMENT_ARRAY_BUFFER, elements.size()*sizeof(GLuint),
+				elements.data(), GL_STATIC_DRAW);
+		}
 
-	// Create and upload new normal map texture
-	int nmDetail = m_terrain->getNormalMapDetail();
-	normalTexture.sub(m_terrain->getNormalMap(nmDetail).data(), GL_RGB, GL_FLOAT, 256*nmDetail, 256* nmDetail);
-	m_terrain->freeNormalMap();
-	checkGLError("Gui::generateTerrain(..) -> Upload new normal texture");
+		// Create new normal map texture and upload it band by band, while the next band is calculated
+		GLenum compression = terrain->getNormalCompression();
+		if (compression != GL_NONE)
+			staged->normalTexture = new Texture(vector<const void*>{ nullptr }, terrain->getNormalMapWidth(),
+				terrain->getNormalMapHeight(), compression, GL_REPEAT, GL_LINEAR, 0);
+		else
+			staged->normalTexture = new Texture(nullptr, terrain->getNormalMapWidth(), terrain->getNormalMapHeight(),
+				terrain->getNormalPixelFormat(), GL_REPEAT, GL_LINEAR, 0, terrain->getNormalType());
+		terrain->streamNormalMap([staged, terrain, compression](unsigned z0, unsigned rows, const void *normals) {
+			if (compression != GL_NONE)
+				staged->normalTexture->subCompressedRows(normals, compression, z0, rows);
+			else
+				staged->normalTexture->subRows(normals, terrain->getNormalPixelFormat(), terrain->getNormalType(), z0, rows);
+		}, terrain->getHeights());
+		checkGLError("Gui::generateTerrain(..) -> Upload new normal texture");
+	},
+	[this, staged, pulling, &normalTexture, &heightTexture, terrainBuffer]() {
+		// Exchange the normal map texture and the height texture or the buffer objects
+		normalTexture.swap(*staged->normalTexture);
+		delete staged->normalTexture;
+		if (staged->heightTexture) {
+			heightTexture.swap(*staged->heightTexture);
+			delete staged->heightTexture;
+			if (staged->ebo)
+				m_terrain->adoptElements(staged->ebo, staged->elementCount);
+		}
+		else {
+			terrainBuffer->adopt(staged->grid, staged->ebo, staged->vertexCount, staged->elementCount);
+			terrainBuffer->adoptStream(staged->heights);
+		}
 
-	// Upload new vertex data to the vertex buffer object
-    if(m_terrain->getVPR()*m_terrain->getVPC() == terrainBuffer.getVertexCount())
-        terrainBuffer.upload(m_terrain->getVertices());
-	else {
-		// Only calculate new element list when the vertex count differ.
-		m_terrain->calculateElements();
-		terrainBuffer.upload(m_terrain->getVertices(), m_terrain->getElements(), GL_DYNAMIC_DRAW);
-	}
-	m_terrain->freeVertices();
+		// Upload the new surface and height range with the terrain shader program
+		GLState::useProgram(m_terrain->getProgramId());
+		m_terrain->uploadSurface();
+
+		// Switch back to gui shader
+		getGuiShader()->use();
+
+		// Update information panel
+		m_infoPanel->getLabelAt("label_VertexCount")->text(L"Vertices: " + 
+			to_wstring(m_terrain->getVPR()*m_terrain->getVPC()), font);
+		m_infoPanel->getLabelAt("label_NormalMapResolution")->text(L"Normal-Map Pixel: " + 
+			to_wstring(m_terrain->getNormalMapWidth()) + L"x" + to_wstring(m_terrain->getNormalMapHeight()), font);
+		unsigned triangles = 2 * (m_terrain->getVPR() - 1) * (m_terrain->getVPC() - 1);
+		if (m_terrain->getAdaptiveDrawn())
+			triangles = staged->elementCount / 3;
+		m_infoPanel->getLabelAt("label_TriangleCount")->text(L"Dreiecke: " + to_wstring(triangles), font);
+
+		// Vertex shader invocations per triangle. Without elements no vertex is reused.
+		if (pulling && !m_terrain->getPulledIndexed())
+			staged->acmr = m_terrain->getPulledVertexCount() / float(triangles);
+		if (staged->acmr >= 0.0f)
+			m_infoPanel->getLabelAt("label_ACMR")->text(L"ACMR: " + to_wstring(staged->acmr).substr(0, 4), font);
+		checkGLError("Gui::generateTerrain(..) -> End of the function");
+	},
+	[staged]() {
+		// The loader is destroyed before the objects were exchanged
+		delete staged->normalTexture;
+		delete staged->heightTexture;
+		GLuint buffers[] = { staged->heights, staged->grid, staged->ebo };
+		GLState::deleteBuffers(3, buffers);
+	});
+}
 
-	// Switch back to gui shader
+void Gui::generateSeamlessTexture(Texture &seamlessTexture, const Noise &noise, unsigned resolution, Loader &loader){
+	// Disable the seamless texture until it's ready
+	m_seamlessTexReady = false;
+	GLState::useProgram(m_terrain->getProgramId());
+	m_terrain->setSeamlessTexEnabled(false);
 	getGuiShader()->use();
+	m_infoPanel->getLabelAt("label_SeamlessTexture")->text(L"Noise Textur: wird erzeugt", font);
+
+	Terrain *terrain = m_terrain;
+	Texture *target = &seamlessTexture;
+	const Noise *n = &noise;
+	Loader *l = &loader;
+	GLenum compression = terrain->getNormalCompression();
+	shared_ptr<vector<vector<GLubyte>>> levels = make_shared<vector<vector<GLubyte>>>();
+	loader.prepare([terrain, n, resolution, compression, levels]() {
+		// Calculate and pack the normals, for compressed textures together with their mipmaps
+		const vector<vec3> &normals = terrain->getSeamlessMap(*n, resolution);
+		if (compression != GL_NONE)
+			Terrain::compressNormalMipmaps(normals, resolution, resolution, 5, *levels);
+		else {
+			levels->resize(1);
+			levels->front().resize(normals.size() * terrain->getNormalSize());
+			terrain->packNormals(normals.data(), normals.size(), levels->front().data());
+		}
+		terrain->freeSeamlessMap();
+	},
+	[this, terrain, target, resolution, l, compression, levels]() {
+		// Only the upload runs on the loader thread
+		l->loadTexture(*target, [terrain, levels, compression, resolution]() {
+			if (compression != GL_NONE) {
+				vector<const void*> data;
+				for (auto &level : *levels)
+					data.push_back(level.data());
+				return new Texture(data, resolution, resolution, compression, GL_REPEAT, GL_LINEAR_MIPMAP_NEAREST, 1);
+			}
+			return new Texture(levels->front().data(), resolution, resolution, terrain->getNormalPixelFormat(),
+				GL_REPEAT, GL_LINEAR_MIPMAP_NEAREST, 1, terrain->getNormalType());
+		}, [this]() { seamlessTextureReady(); });
+	});
+}
 
-	// Update information panel
-	m_infoPanel->getLabelAt("label_VertexCount")->text(L"Vertices: " + 
-		to_wstring(m_terrain->getVPR()*m_terrain->getVPC()), font);
-	m_infoPanel->getLabelAt("label_NormalMapResolution")->text(L"Normal-Map Pixel: " + 
-		to_wstring(m_terrain->getNormalMapWidth()) + L"x" + to_wstring(m_terrain->getNormalMapHeight()), font);
-	checkGLError("Gui::generateTerrain(..) -> End of the function");
+void Gui::seamlessTextureReady(){
+	m_seamlessTexReady = true;
+	GLState::useProgram(m_terrain->getProgramId());
+	m_terrain->setSeamlessTexEnabled(m_seamlessTexWanted);
+	getGuiShader()->use();
+	m_infoPanel->getLabelAt("label_SeamlessTexture")->text(L"Noise Textur: bereit", font);
 }
 
 void Gui::modifySurfaceSize(int value){
@@ -506,13 +698,16 @@ void Gui::changeToCosinusClicked() {
 }
 
 void Gui::activateTextureClicked() {
-	if (m_terrain->getSeamlessTexEnabled()) {
-		m_terrain->setSeamlessTexEnabled(false);
+	// The terrain only gets the user's choice when the texture is ready
+	m_seamlessTexWanted = !m_seamlessTexWanted;
+	if (m_seamlessTexReady)
+		m_terrain->setSeamlessTexEnabled(m_seamlessTexWanted);
+
+	if (!m_seamlessTexWanted) {
 		m_mainPanel->getButtonAt("button_activateTexture")->color(0.1f, 0.1f, 0.4f, 0.5f);
 		m_mainPanel->getButtonAt("button_activateTexture")->text(L"Noise Textur deaktiviert", font);
 	}
 	else {
-		m_terrain->setSeamlessTexEnabled(true);
 		m_mainPanel->getButtonAt("button_activateTexture")->color(0.2f, 0.2f, 0.8f, 0.5f);
 		m_mainPanel->getButtonAt("button_activateTexture")->text(L"Noise Textur aktiviert", font);
 	}
@@ -523,6 +718,13 @@ void Gui::reorderPanels() {
 	m_infoPanel->reorder(getMainWindow()->getWidth() - 200, 0);
 	m_infoPanel->getLabelAt("label_VertexCount")->reorder(getMainWindow()->getWidth() - 200, 10);
 	m_infoPanel->getLabelAt("label_NormalMapResolution")->reorder(getMainWindow()->getWidth() - 200, 30);
+	m_infoPanel->getLabelAt("label_TriangleCount")->reorder(getMainWindow()->getWidth() - 200, 50);
+	m_infoPanel->getLabelAt("label_ACMR")->reorder(getMainWindow()->getWidth() - 200, 70);
+	m_infoPanel->getLabelAt("label_SeamlessTexture")->reorder(getMainWindow()->getWidth() - 200, 90);
+	m_infoPanel->getLabelAt("label_GLCalls")->reorder(getMainWindow()->getWidth() - 200, 110);
+	m_infoPanel->getLabelAt("label_FrameTimes")->reorder(getMainWindow()->getWidth() - 200, 130);
+	m_infoPanel->getLabelAt("label_CpuTimes")->reorder(getMainWindow()->getWidth() - 200, 150);
+	m_infoPanel->getLabelAt("label_GpuTimes")->reorder(getMainWindow()->getWidth() - 200, 170);
 	m_noisePanel->reorder(187, 245);
 	m_noisePanel->getButtonAt("button_changeToPerlin")->reorder(192, 250);
 	m_noisePanel->getButtonAt("button_changeToBillowy")->reorder(192, 273);
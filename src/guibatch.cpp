@@ -0,0 +1,235 @@
+#include "guibatch.h"
+#include "window.h"
+
+GuiBatch::GuiBatch(const Shader *shader, GLuint texUnit, GLuint layerUnit)
+	: m_shader(shader), m_buffer(nullptr), m_capacity(0), m_drawnQuads(0), m_shelfX(0), m_shelfY(0), m_shelfHeight(0),
+	m_framebuffer(0), m_layer(nullptr), m_layerUnit(layerUnit), m_layerValid(false), m_redrawn(false), m_dirty(true), m_collecting(false), m_regionCount(0)
+{
+	checkGLError("GuiBatch(..) -> Error occured before this call");
+
+	// Empty atlas, the fonts store their glyphs when they are used the first time
+	m_atlas = new Texture(nullptr, AtlasSize, AtlasSize, GL_RED, GL_CLAMP_TO_EDGE, GL_NEAREST, texUnit, GL_UNSIGNED_BYTE);
+	m_shader->use();
+	glUniform1i(m_shader->getUniformLocation("tex"), texUnit);
+	glUniform1i(m_shader->getUniformLocation("layer"), layerUnit);
+	m_compositeLoc = m_shader->getUniformLocation("composite");
+
+	// Fully covered area for the backgrounds
+	const GLubyte white[2 * 2] = { 255, 255, 255, 255 };
+	allocate(2, 2, m_white);
+	store(white, m_white, 2, 2);
+	m_white = vec4(1.0f / AtlasSize);
+
+	// Space for the quads of the whole gui, it grows if needed
+	reserve(1024);
+
+	// Buffer for the regions of the cached layer, it is filled when the quads were collected
+	const vec2 screen[2] = { vec2(-1.0f, 1.0f), vec2(1.0f, -1.0f) };
+	add(screen, vec4(0.0f, 0.0f, 1.0f, 1.0f), vec4(1.0f));
+	m_regionQuads = new Buffer<GuiVertex>(m_vertices, { 0, 1, 2, 2, 1, 3 }, GL_STATIC_DRAW);
+	m_regionQuads->attrib(m_shader->getId(), "position", 2, 3, 0);
+	m_regionQuads->attrib(m_shader->getId(), "texCoord", 2, 3, 2);
+	m_regionQuads->attrib(m_shader->getId(), "color", 4, 3, 4);
+	m_vertices.clear();
+	checkGLError("GuiBatch(..)");
+}
+
+GuiBatch::~GuiBatch(){
+	if (m_framebuffer)
+		glDeleteFramebuffers(1, &m_framebuffer);
+	delete m_layer;
+	delete m_regionQuads;
+	delete m_buffer;
+	delete m_atlas;
+}
+
+bool GuiBatch::allocate(unsigned width, unsigned height, vec4 &texCoords){
+	// Areas are placed in rows, one pixel apart so that they don't bleed into each other
+	if (m_shelfX + width > AtlasSize) {
+		m_shelfX = 0;
+		m_shelfY += m_shelfHeight + 1;
+		m_shelfHeight = 0;
+	}
+	if (width > AtlasSize || m_shelfY + height > AtlasSize) {
+		printError("GuiBatch::allocate(..)", "Atlas is full. No area allocated.");
+		return false;
+	}
+
+	texCoords = vec4(float(m_shelfX), float(m_shelfY), float(m_shelfX + width), float(m_shelfY + height)) / float(AtlasSize);
+	m_shelfX += width + 1;
+	m_shelfHeight = std::max(m_shelfHeight, height);
+	return true;
+}
+
+void GuiBatch::store(const GLubyte *coverage, const vec4 &texCoords, unsigned width, unsigned height){
+	m_atlas->subRect(coverage, GL_RED, GL_UNSIGNED_BYTE, unsigned(texCoords.x * AtlasSize + 0.5f),
+		unsigned(texCoords.y * AtlasSize + 0.5f), width, height);
+}
+
+void GuiBatch::add(const vec2 corners[2], const vec4 &texCoords, const vec4 &color){
+	// Same order as the triangle strip the blocks were drawn with before
+	m_vertices.push_back({ vec2(corners[0].x, corners[0].y), vec2(texCoords.x, texCoords.w), color });
+	m_vertices.push_back({ vec2(corners[0].x, corners[1].y), vec2(texCoords.x, texCoords.y), color });
+	m_vertices.push_back({ vec2(corners[1].x, corners[0].y), vec2(texCoords.z, texCoords.w), color });
+	m_vertices.push_back({ vec2(corners[1].x, corners[1].y), vec2(texCoords.z, texCoords.y), color });
+}
+
+bool GuiBatch::begin(){
+	// A resized window needs a new layer, which is empty
+	unsigned width = getMainWindow()->getWidth(), height = getMainWindow()->getHeight();
+	if (!m_layer || m_layer->getWidth() != width || m_layer->getHeight() != height)
+		createLayer(width, height);
+
+	// Without a framebuffer the quads are drawn directly every frame. Changes during this frame are
+	// collected in the next one.
+	m_collecting = m_dirty || !m_layerValid || !m_framebuffer;
+	m_dirty = false;
+	m_vertices.clear();
+	return m_collecting;
+}
+
+void GuiBatch::draw(){
+	bool collected = m_collecting;
+	m_collecting = false;
+	m_drawnQuads = 0;
+	m_redrawn = false;
+	if (!collected) {
+		m_vertices.clear();
+		if (m_regionCount == 0)
+			return;
+	}
+
+	checkGLError("GuiBatch::draw() -> Error occured before this call");
+
+	m_shader->use();
+	glDisable(GL_DEPTH_TEST);
+	glCullFace(GL_BACK);
+
+	if (collected) {
+		unsigned quads = unsigned(m_vertices.size() / 4);
+		m_drawnQuads = quads;
+		m_redrawn = true;
+
+		if (!m_framebuffer) {
+			if (quads > 0)
+				drawQuads(quads);
+			m_vertices.clear();
+			checkGLError("GuiBatch::draw()");
+			return;
+		}
+
+		// Draw into the cleared layer. The colors are stored premultiplied with their alpha, so that
+		// the layer can be blended like the quads were blended directly.
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		const GLfloat transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		glClearBufferfv(GL_COLOR, 0, transparent);
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		if (quads > 0)
+			drawQuads(quads);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		m_layerValid = true;
+
+		// Only the panels are blended onto the window, not the transparent rest of the layer
+		updateRegions();
+	}
+
+	// Composite the layer with one quad per region
+	if (m_regionCount > 0) {
+		glUniform1ui(m_compositeLoc, GL_TRUE);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		m_layer->use();
+		m_regionQuads->use();
+		glDrawElements(GL_TRIANGLES, m_regionCount * 6, GL_UNSIGNED_INT, 0);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glUniform1ui(m_compositeLoc, GL_FALSE);
+	}
+	checkGLError("GuiBatch::draw()");
+}
+
+void GuiBatch::updateRegions(){
+	// Rectangles as left, bottom, right and top edge. A quad that overlaps or touches a rectangle is
+	// merged with it and the result is checked against the others again. Most quads lie within the
+	// background of their panel, so there are only few rectangles.
+	vector<vec4> regions;
+	for (size_t v = 0; v < m_vertices.size(); v += 4) {
+		vec4 r(m_vertices[v].position.x, m_vertices[v + 3].position.y, m_vertices[v + 3].position.x, m_vertices[v].position.y);
+		for (size_t i = 0; i < regions.size();) {
+			const vec4 &o = regions[i];
+			if (r.x <= o.z && o.x <= r.z && r.y <= o.w && o.y <= r.w) {
+				r = vec4(std::min(r.x, o.x), std::min(r.y, o.y), std::max(r.z, o.z), std::max(r.w, o.w));
+				regions.erase(regions.begin() + i);
+				i = 0;
+			}
+			else
+				i++;
+		}
+		regions.push_back(r);
+	}
+
+	// The layer has the size of the window, so its texture coordinates follow from the positions
+	m_vertices.clear();
+	vector<GLuint> elements;
+	for (const vec4 &r : regions) {
+		const vec2 corners[2] = { vec2(r.x, r.w), vec2(r.z, r.y) };
+		add(corners, vec4(r.x + 1.0f, r.y + 1.0f, r.z + 1.0f, r.w + 1.0f) * 0.5f, vec4(1.0f));
+		GLuint v = GLuint(elements.size() / 6 * 4);
+		elements.insert(elements.end(), { v, v + 1, v + 2, v + 2, v + 1, v + 3 });
+	}
+	m_regionCount = unsigned(regions.size());
+	if (m_regionCount > 0)
+		m_regionQuads->upload(m_vertices, elements, GL_STATIC_DRAW);
+	m_vertices.clear();
+}
+
+void GuiBatch::drawQuads(unsigned quads){
+	// Upload the vertices of this frame, the buffers only grow when the gui got more quads
+	if (quads > m_capacity)
+		reserve(quads * 2);
+	m_buffer->upload(m_vertices);
+
+	m_atlas->use();
+	glDrawElements(GL_TRIANGLES, quads * 6, GL_UNSIGNED_INT, 0);
+}
+
+void GuiBatch::createLayer(unsigned width, unsigned height){
+	checkGLError("GuiBatch::createLayer(..) -> Error occured before this call");
+
+	delete m_layer;
+	m_layer = new Texture(nullptr, width, height, GL_RGBA, GL_CLAMP_TO_EDGE, GL_NEAREST, m_layerUnit, GL_UNSIGNED_BYTE);
+	m_layerValid = false;
+
+	if (!m_framebuffer)
+		glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_layer->getId(), 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		printError("GuiBatch::createLayer(..)", "Framebuffer is incomplete. The gui is drawn directly.");
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	checkGLError("GuiBatch::createLayer(..)");
+}
+
+void GuiBatch::reserve(unsigned quads){
+	// Two triangles per quad with the same winding as the triangle strip 0, 1, 2, 3
+	vector<GLuint> elements;
+	elements.reserve(quads * 6);
+	for (GLuint q = 0; q < quads; q++) {
+		GLuint v = q * 4;
+		elements.insert(elements.end(), { v, v + 1, v + 2, v + 2, v + 1, v + 3 });
+	}
+	vector<GuiVertex> vertices(quads * 4);
+	m_capacity = quads;
+
+	if (m_buffer)
+		m_buffer->upload(vertices, elements, GL_DYNAMIC_DRAW);
+	else {
+		m_buffer = new Buffer<GuiVertex>(vertices, elements, GL_DYNAMIC_DRAW);
+		m_buffer->attrib(m_shader->getId(), "position", 2, 3, 0);
+		m_buffer->attrib(m_shader->getId(), "texCoord", 2, 3, 2);
+		m_buffer->attrib(m_shader->getId(), "color", 4, 3, 4);
+	}
+}
@@ -0,0 +1,17 @@
+#include "heightfield.h"
+
+Heightfield::Heightfield() : m_width(0), m_height(0), m_tilesX(0), m_tilesY(0) {}
+
+Heightfield::Heightfield(unsigned width, unsigned height) : Heightfield() {
+	resize(width, height);
+}
+
+void Heightfield::resize(unsigned width, unsigned height){
+	m_width = width;
+	m_height = height;
+
+	// Round up to whole tiles
+	m_tilesX = (width + TileSize - 1) / TileSize;
+	m_tilesY = (height + TileSize - 1) / TileSize;
+	m_values.resize(m_tilesX * m_tilesY * TileSize * TileSize);
+}
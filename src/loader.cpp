@@ -0,0 +1,191 @@
+#include "loader.h"
+
+Loader::Loader(Window &window, bool async)
+	: m_window(&window), m_context(nullptr), m_async(false), m_fences(false), m_stop(false), m_pending(0), m_preparing(0)
+{
+	if (async) {
+		// Create the context for the loader thread
+		m_context = m_window->createSharedContext();
+
+		if (m_context) {
+			// Fences are core since OpenGL 3.2, otherwise fall back to glFinish on the loader thread
+			m_fences = GLEW_ARB_sync ? true : false;
+			m_async = true;
+			m_thread = thread(&Loader::run, this);
+		}
+		else
+			printError("Loader(..)", "Shared context could not be created. Jobs run on the render thread.");
+	}
+}
+
+Loader::~Loader(){
+	// The prepared jobs may still submit jobs
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_prepared.wait(lock, [this] { return m_preparing == 0; });
+	}
+
+	if (m_async) {
+		// Wake up and stop the loader thread
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+
+		// Delete the fences and the objects of jobs that never got finished. The objects are shared
+		// with the main context, which is current on this thread.
+		for (auto &c : m_completions) {
+			if (c.fence)
+				glDeleteSync(c.fence);
+			if (c.discard)
+				c.discard();
+		}
+		m_completions.clear();
+
+		SDL_GL_DeleteContext(m_context);
+	}
+}
+
+void Loader::submit(function<void()> job, function<void()> done, function<void()> discard){
+	// Without a loader thread, both parts simply run one after the other
+	if (!m_async) {
+		job();
+		done();
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_jobs.push_back({ job, done, discard });
+		m_pending++;
+	}
+	m_wake.notify_one();
+}
+
+void Loader::loadTexture(Texture &target, function<Texture*()> create, function<void()> ready){
+	// Holds the texture from the loader thread until it is swapped on the render thread
+	shared_ptr<Texture*> staged = make_shared<Texture*>(nullptr);
+	Texture *t = &target;
+
+	submit([staged, create]() { *staged = create(); },
+		[staged, t, ready]() {
+			t->swap(**staged);
+			delete *staged;
+			if (ready)
+				ready();
+		},
+		[staged]() { delete *staged; });
+}
+
+void Loader::loadTexture(Texture &target, const string &file, GLint wrapper, GLint filter, function<void()> ready){
+	// Decoded on a worker, uploaded on the loader thread
+	shared_ptr<TextureImage> image = make_shared<TextureImage>();
+	Texture *t = &target;
+	prepare([image, file]() { Texture::decode(file, *image); },
+		[this, t, image, wrapper, filter, ready]() {
+			// The error was printed by the decoder, keep the old texture
+			if (image->levels.empty())
+				return;
+			GLuint unit = t->getUnit();
+			loadTexture(*t, [image, wrapper, filter, unit]() { return new Texture(*image, wrapper, filter, unit); }, ready);
+		});
+}
+
+void Loader::prepare(function<void()> work, function<void()> then){
+	// Without a loader thread the jobs need the calling thread and its context anyway
+	if (!m_async) {
+		work();
+		then();
+		return;
+	}
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_pending++;
+		m_preparing++;
+	}
+	WorkerPool::post([this, work, then]() {
+		work();
+		then();
+
+		// The job submitted by "then" is pending already, so the count never drops in between
+		lock_guard<mutex> lock(m_mutex);
+		m_pending--;
+		if (--m_preparing == 0)
+			m_prepared.notify_all();
+	});
+}
+
+void Loader::poll(){
+	if (!m_async)
+		return;
+
+	while (true) {
+		Completion c;
+		{
+			lock_guard<mutex> lock(m_mutex);
+			if (m_completions.empty())
+				return;
+			c = m_completions.front();
+
+			// Keep the submission order, so stop at the first job that is not ready yet
+			if (c.fence) {
+				GLenum status = glClientWaitSync(c.fence, 0, 0);
+				if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+					return;
+				glDeleteSync(c.fence);
+			}
+			m_completions.pop_front();
+		}
+
+		// Exchange the handles outside of the lock, the done function may submit new jobs
+		c.done();
+
+		lock_guard<mutex> lock(m_mutex);
+		m_pending--;
+	}
+}
+
+unsigned Loader::getPending()const{
+	lock_guard<mutex> lock(m_mutex);
+	return m_pending;
+}
+
+void Loader::run(){
+	// The shared context is only current on this thread
+	m_window->makeCurrent(m_context);
+	enableGLDebugOutput();
+	checkGLError("Loader::run() -> Error occured before this call");
+
+	while (true) {
+		Job job;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+			if (m_stop)
+				break;
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		// Run the loading part of the job
+		job.job();
+
+		// Put a fence behind the job's commands and flush them, so that the fence can signal
+		GLsync fence = nullptr;
+		if (m_fences) {
+			fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+		}
+		else
+			glFinish();
+		checkGLError("Loader::run() -> Fence after job");
+
+		lock_guard<mutex> lock(m_mutex);
+		m_completions.push_back({ fence, job.done, job.discard });
+	}
+
+	// Release the context before it is deleted on the main thread
+	m_window->makeCurrent(nullptr);
+}
@@ -13,16 +13,23 @@
 #include "shader.h"
 #include "glm.h"
 #include "gui.h"
+#include "loader.h"
+#include "profiler.h"
 
 int main(int argc, char** argv)
 {
+	// Offline converter: bakes the mipmaps of the textures into compressed containers, which are
+	// loaded instead of the '.bmp' files afterwards
+	if (argc > 1 && string(argv[1]) == "--convert") {
+		bool converted = Texture::convertToContainer("textures/smooth_rock_01.bmp", "textures/smooth_rock_01.ktx", true);
+		converted = Texture::convertToContainer("textures/stone_big_01.bmp", "textures/stone_big_01.ktx", true) && converted;
+		return converted ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	// Create and open a resizable window
 	Window wnd(900, 650);
 	wnd.open(Style::Resizable);
 
-	// Loading shader
-	Shader terrainShader("shader/terrain.vsh", "shader/terrain.fsh");
-
 	/* GL CONFIGURATIONS */
 	glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
@@ -33,9 +40,6 @@ int main(int argc, char** argv)
 	glEnable(GL_PRIMITIVE_RESTART);
 	glPrimitiveRestartIndex(~0);
 
-	// Create camera and setup view
-	Camera cam(vec3(0.0f, 50.0f, 30.0f), terrainShader.getId());
-
 	// Noise start up parameter
 	int seed = 5;
 	int layerCount = 1;
@@ -49,117 +53,173 @@ int main(int argc, char** argv)
 	Noise terrainNoise(seed, layerCount, startFrequency, frequencyDivisor, weightDivisor, amplitude);
 	Noise seamlessNoise(20340, 10, 2, 10, seamRes, 2.2f, 100.0f);
 
-	// Generate terrain
-	Terrain terrain(terrainNoise, 128, 128, 1, 1, terrainShader.getId());
+	// Generate terrain, which compiles the variants of its shader program that its state needs
+	Terrain terrain(terrainNoise, 128, 128, 1, 1, "shader/terrain.vsh", "shader/terrain.fsh", "shader/terrain.cache");
+
+	// Create camera and setup view
+	Camera cam(vec3(0.0f, 50.0f, 30.0f), terrain.getProgramId());
+
+	// Create the loader that uploads textures and buffers on its own thread with a shared context
+	Loader *loader = new Loader(wnd, true);
 
 	/* Texturing */
-	// Create normal map for the terrain
-	Texture normalTexture(terrain.getNormalMap(terrain.getNormalMapDetail()).data(),
-		terrain.getNormalMapWidth(), terrain.getNormalMapHeight(), GL_RGB, GL_REPEAT, GL_LINEAR, 0);
+	// Empty textures that get their texture objects from the loader as soon as they are ready
+	Texture normalTexture(0);
+	Texture seamlessTexture(1);
+	Texture stoneSmoothTex(2);
+	Texture stoneTex(3);
+	Texture heightTexture(4);
 	terrain.applyTexture("normalTex", normalTexture.getUnit());
-	terrain.freeNormalMap();
-
-	// Create Seamless noise texture for the terrain
-    Texture seamlessTexture(terrain.getSeamlessMap(seamlessNoise, seamRes).data(),
-		seamRes, seamRes, GL_RGB, GL_REPEAT, GL_LINEAR_MIPMAP_NEAREST, 1);
 	terrain.applyTexture("seamlessTex", seamlessTexture.getUnit());
-	terrain.freeSeamlessMap();
-
-    // Load textures from files and apply them to the terrain
-	Texture stoneSmoothTex("textures/smooth_rock_01.bmp", GL_REPEAT, GL_LINEAR_MIPMAP_NEAREST, 2);
 	terrain.applyTexture("stoneDetailTex", stoneSmoothTex.getUnit());
-	Texture stoneTex("textures/stone_big_01.bmp", GL_REPEAT, GL_LINEAR_MIPMAP_NEAREST, 3);
 	terrain.applyTexture("stoneTex", stoneTex.getUnit());
+	terrain.applyTexture("heightTex", heightTexture.getUnit());
+
+	// Choose 16 bit heights, which are pulled from a height texture by the vertex shader
+	terrain.setHeightFormat(HeightFormat::Unorm16);
+	terrain.setVertexSource(VertexSource::HeightTexture);
+
+	// Triangulate the terrain adaptively, with a height error of at most 0.2 units
+	terrain.setMaxError(0.2f);
 
-	// Upload terrain data
-	Buffer<Vertex> *terrainBuffer = new Buffer<Vertex>(terrain.getVertices(), terrain.getElements(), GL_DYNAMIC_DRAW);
-	terrainBuffer->attrib(terrain.getProgramId(), "position", 3, 2, 0);
-	terrainBuffer->attrib(terrain.getProgramId(), "texCoord", 2, 2, 3);
+	// Order the strips of the full grid for the post-transform vertex cache
+	terrain.setElementOrder(ElementOrder::Blocks);
+
+	// Store the normal map and the seamless map block compressed with 1 byte per texel
+	terrain.setNormalFormat(NormalFormat::Rgtc2);
+
+	// Upload the static grid and the elements, which are only needed without vertex pulling.
+	// The heights are uploaded by the generation below.
+	Buffer<vec2> *terrainBuffer = nullptr;
+	if (terrain.getVertexSource() == VertexSource::Streams) {
+		terrainBuffer = new Buffer<vec2>(terrain.getGrid(), terrain.getElements(), GL_STATIC_DRAW);
+		terrainBuffer->attrib(terrain.getProgramId(), "texCoord", 2, 1, 0);
+		terrainBuffer->streamAttrib(terrain.getProgramId(), "height", 1, terrain.getHeightType(),
+			terrain.getHeightFormat() == HeightFormat::Unorm16 ? GL_TRUE : GL_FALSE);
+	}
 	terrain.freeVertices();
 
+    // Load textures from files, or from their containers after they were converted with --convert
+	// They are decoded on the worker pool while the terrain is generated.
+	// The stone detail is only sampled when its texture is ready.
+	loader->loadTexture(stoneSmoothTex, Texture::preferContainer("textures/smooth_rock_01.bmp"), GL_REPEAT, GL_LINEAR_MIPMAP_NEAREST,
+		[&]() { GLState::useProgram(terrain.getProgramId()); terrain.setStoneDetailEnabled(true); });
+	loader->loadTexture(stoneTex, Texture::preferContainer("textures/stone_big_01.bmp"), GL_REPEAT, GL_LINEAR_MIPMAP_NEAREST);
+
     // Create user interface
     Gui *gui = new Gui(terrain);
 
+	// Generate the terrain when the correspondent button was clicked
+	gui->setGenerateAction([&]() { gui->generateTerrain(normalTexture, heightTexture, terrainBuffer, *loader); });
+
+	// Generate the heights and the normal map of the terrain
+	gui->generateTerrain(normalTexture, heightTexture, terrainBuffer, *loader);
+
+	// Generate the seamless noise texture in the background, it is enabled as soon as it is ready
+	gui->generateSeamlessTexture(seamlessTexture, seamlessNoise, seamRes, *loader);
+
 	// Set relative mouse mode on
 	SDL_SetRelativeMouseMode(SDL_TRUE);
 
-	// Main loop
+	// Measures the phases of the main loop for the information panel
+	Profiler profiler;
+
+	// Panels shown in the last frame, one bit per panel
+	unsigned lastVisiblePanels = 0;
+
+	// Main loop. A frame starts before the events are handled and the buffers are swapped.
+	profiler.beginFrame();
 	while (wnd.update()){
+		profiler.mark(Phase::Input);
 
 		// Clear window
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		// Exchange textures and buffers that were finished by the loader
+		loader->poll();
+		profiler.mark(Phase::Loader);
+
 		/* TERRAIN */
-		// Use terrain shader program
-		terrainShader.use();
+		// Use the variant of the terrain shader program for the current state
+		GLState::useProgram(terrain.getProgramId());
+		cam.setProgram(terrain.getProgramId());
 
 		// Use terrain buffer
-		terrainBuffer->use();
+		if (terrainBuffer)
+			terrainBuffer->use();
 
 		// Use terrain textures
 		normalTexture.use();
 		seamlessTexture.use();
 		stoneSmoothTex.use();
 		stoneTex.use();
+		heightTexture.use();
 
 		// Update camera position and viewing direction
 		cam.update();
+		profiler.mark(Phase::Camera);
 
 		// Enable depth values and draw terrain
 		glEnable(GL_DEPTH_TEST);
-        terrain.draw();
+		profiler.beginPass(Pass::Terrain);
+        terrain.draw(terrainBuffer ? terrainBuffer->getElementCount() : 0);
+		profiler.endPass();
+		profiler.mark(Phase::Terrain);
 
-		// Handle inc- or decrease events for the terrain's brightness
-		gui->updateBrightness();
+		/* GRAPHICAL USER INTERFACE */
+		// Handle the mouse events of this frame. The terrain must not be modified while the loader uses it.
+		gui->update(wnd.getMouseEvents(), !SDL_GetRelativeMouseMode(), loader->getPending() == 0);
+		gui->updateInfo(profiler);
+
+		// Showing or hiding a panel changes the gui like a changed block
+		bool showPanels = !SDL_GetRelativeMouseMode();
+		bool showLoading = gui->getGeneratePressed() || loader->getPending() > 0;
+		unsigned visiblePanels = unsigned(showPanels) | unsigned(gui->getShowNoisePanel()) << 1 |
+			unsigned(showLoading) << 2 | unsigned(gui->getShowInfo()) << 3;
+		if (visiblePanels != lastVisiblePanels) {
+			getGuiBatch()->invalidate();
+			lastVisiblePanels = visiblePanels;
+		}
 
-		// Update whether seamless texture shall be enabled or not
-		gui->updateTextureEnabling();
+		// The blocks are only collected when the gui changed, otherwise the gui batch draws its cached layer
+		if (getGuiBatch()->begin()) {
+			if (showPanels) {
+				// Draw main panel
+				gui->getMainPanel()->update();
 
-		/* GRAPHICAL USER INTERFACE */
-		// Use the gui shader program for drawing the gui
-		getGuiShader()->use();
-		if (!SDL_GetRelativeMouseMode()) {
-			// Disable depth values when drawing gui
-			glDisable(GL_DEPTH_TEST);
-
-			// Draw main panel
-			gui->getMainPanel()->update();
-
-			// Handle events for the changing noise panel
-			gui->updateNoisePanelEvents();
-
-			// Draw noise type panel when it should be shown
-			if (gui->getShowNoisePanel())
-				gui->getNoisePanel()->update();
-			else {
-				// Handle GUI events for the main panel
-				gui->update();
-
-				// Generate terrain when the correspondent button was clicked
-				if (gui->getMainPanel()->getButtonAt("button_generate")->getState() == StateId::Released)
-					gui->generateTerrain(normalTexture, *terrainBuffer);
+				// Draw noise type panel when it should be shown
+				if (gui->getShowNoisePanel())
+					gui->getNoisePanel()->update();
+
+				// Draw loading label when the terrain is being generated
+				if (showLoading)
+					gui->getLoadingLabel()->update();
 			}
 
-			// Draw loading label when the terrain is being generated
-			if (gui->getMainPanel()->getButtonAt("button_generate")->getState() == StateId::Pressed)
-				gui->getLoadingLabel()->update();
+			// Draw info panel
+			if (gui->getShowInfo())
+				gui->getInfoPanel()->update();
+			gui->updateFrameGraph();
 		}
 
-		// Draw info panel
-		if (gui->getShowInfo())
-			gui->getInfoPanel()->update();
-		gui->updateInfo();
+		// Draw all collected blocks with one draw call
+		profiler.beginPass(Pass::Gui);
+		getGuiBatch()->draw();
+		profiler.endPass();
 
 		// Reorder info panel when window was resized
 		if (wnd.resized())
 			gui->reorderPanels();
+		profiler.mark(Phase::Gui);
 
-
+		profiler.beginFrame();
 	}
 
-	// Free all allocated memory at the end
-	delete terrainBuffer;
+	// Free all allocated memory at the end. The loader waits for its prepared jobs, which may still
+	// refer to the gui, but are dropped.
 	delete gui;
+	delete loader;
+	delete terrainBuffer;
 
 	// Close window and delete the existing OpenGL context
 	wnd.close();
@@ -0,0 +1,59 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const string &path) : m_data(nullptr), m_size(0), m_file(nullptr), m_mapping(nullptr) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	m_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		return;
+	m_size = size_t(size.QuadPart);
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping)
+		m_data = (const GLubyte*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+
+	// The mapping stays valid after the file is closed
+	struct stat info;
+	if (fstat(file, &info) == 0 && info.st_size > 0) {
+		void *data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			m_data = (const GLubyte*)data;
+			m_size = size_t(info.st_size);
+		}
+	}
+	close(file);
+#endif
+	if (!m_data)
+		printError("MappedFile(..)", "File " + path + " could not be mapped.");
+}
+
+MappedFile::~MappedFile(){
+#ifdef _WIN32
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file)
+		CloseHandle(m_file);
+#else
+	if (m_data)
+		munmap((void*)m_data, m_size);
+#endif
+}
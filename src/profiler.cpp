@@ -0,0 +1,135 @@
+#include "profiler.h"
+
+Profiler::Profiler()
+	: m_history(HistorySize), m_frames(0), m_current(0), m_started(false), m_buffer(0), m_activePass(Pass::Count)
+{
+	checkGLError("Profiler() -> Error occured before this call");
+
+	// GL_TIME_ELAPSED queries are core since OpenGL 3.3
+	m_timerQueries = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	if (m_timerQueries)
+		glGenQueries(QueryBuffers * unsigned(Pass::Count), &m_queries[0][0]);
+	for (unsigned b = 0; b < QueryBuffers; b++) {
+		m_issuedFrame[b] = 0;
+		for (bool &issued : m_issued[b])
+			issued = false;
+	}
+	checkGLError("Profiler()");
+}
+
+Profiler::~Profiler(){
+	if (m_timerQueries)
+		glDeleteQueries(QueryBuffers * unsigned(Pass::Count), &m_queries[0][0]);
+}
+
+void Profiler::beginFrame(){
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+	// Store the last frame. One slot stays free for the current frame.
+	if (m_started) {
+		m_history[m_current].total = chrono::duration<float, milli>(now - m_frameStart).count();
+		m_current = (m_current + 1) % HistorySize;
+		m_frames = std::min(m_frames + 1, HistorySize - 1);
+	}
+	else {
+		m_lastMark = now;
+		m_started = true;
+	}
+	m_frameStart = now;
+
+	Frame &frame = m_history[m_current];
+	frame.total = 0.0f;
+	for (float &cpu : frame.cpu)
+		cpu = 0.0f;
+	for (float &gpu : frame.gpu)
+		gpu = -1.0f;
+
+	// The queries of this set were issued two frames ago
+	m_buffer = (m_buffer + 1) % QueryBuffers;
+	if (m_timerQueries)
+		readQueries(m_buffer);
+	m_issuedFrame[m_buffer] = m_current;
+}
+
+void Profiler::mark(Phase phase){
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	m_history[m_current].cpu[unsigned(phase)] += chrono::duration<float, milli>(now - m_lastMark).count();
+	m_lastMark = now;
+}
+
+void Profiler::beginPass(Pass pass){
+	if (!m_timerQueries || m_activePass != Pass::Count)
+		return;
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[m_buffer][unsigned(pass)]);
+	m_issued[m_buffer][unsigned(pass)] = true;
+	m_activePass = pass;
+}
+
+void Profiler::endPass(){
+	if (m_activePass == Pass::Count)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	m_activePass = Pass::Count;
+}
+
+void Profiler::readQueries(unsigned buffer){
+	for (unsigned p = 0; p < unsigned(Pass::Count); p++) {
+		if (!m_issued[buffer][p])
+			continue;
+		m_issued[buffer][p] = false;
+
+		// Waiting for the result would stall the CPU, so a late result is dropped
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(m_queries[buffer][p], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(m_queries[buffer][p], GL_QUERY_RESULT, &nanoseconds);
+		m_history[m_issuedFrame[buffer]].gpu[p] = float(nanoseconds / 1.0e6);
+	}
+}
+
+void Profiler::getFrameTimes(float &min, float &avg, float &p99)const{
+	vector<float> times = getHistory();
+	min = avg = p99 = 0.0f;
+	if (times.empty())
+		return;
+
+	std::sort(times.begin(), times.end());
+	min = times.front();
+	for (float t : times)
+		avg += t;
+	avg /= times.size();
+	p99 = times[std::min(times.size() - 1, size_t(times.size() * 0.99f))];
+}
+
+float Profiler::getCpuTime(Phase phase)const{
+	if (m_frames == 0)
+		return 0.0f;
+	float sum = 0.0f;
+	for (unsigned i = 0; i < m_frames; i++)
+		sum += m_history[(m_current + HistorySize - m_frames + i) % HistorySize].cpu[unsigned(phase)];
+	return sum / m_frames;
+}
+
+float Profiler::getGpuTime(Pass pass)const{
+	// Only frames whose results were read count
+	float sum = 0.0f;
+	unsigned count = 0;
+	for (unsigned i = 0; i < m_frames; i++) {
+		float gpu = m_history[(m_current + HistorySize - m_frames + i) % HistorySize].gpu[unsigned(pass)];
+		if (gpu >= 0.0f) {
+			sum += gpu;
+			count++;
+		}
+	}
+	return count > 0 ? sum / count : -1.0f;
+}
+
+vector<float> Profiler::getHistory()const{
+	vector<float> times;
+	times.reserve(m_frames);
+	for (unsigned i = 0; i < m_frames; i++)
+		times.push_back(m_history[(m_current + HistorySize - m_frames + i) % HistorySize].total);
+	return times;
+}
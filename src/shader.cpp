@@ -1,6 +1,6 @@
 #include "shader.h"
 
-Shader::Shader(string vsh, string fsh){
+Shader::Shader(string vsh, string fsh, string cache, const vector<string> &defines){
 	if (vsh.empty())
 		printCriticalError("Shader(vsh, fsh)", "Path string to the vertex shader file is empty");
 	else if(fsh.empty())
@@ -12,10 +12,30 @@ Shader::Shader(string vsh, string fsh){
 		// Generate shader program id
 		m_id = glCreateProgram();
 
+		// Sources of the variant
+		string vshSource = defineSource(loadSource(vsh), defines);
+		string fshSource = defineSource(loadSource(fsh), defines);
+
+		// Program binaries need GL_ARB_get_program_binary and at least one binary format
+		GLint formats = 0;
+		if (!cache.empty() && GLEW_ARB_get_program_binary)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		unsigned long long key = 0;
+		if (formats > 0) {
+			key = cacheKey(vshSource + fshSource);
+
+			// Use the cached binary, if it matches the sources and the driver
+			if (loadBinary(cache, key)) {
+				GLState::useProgram(m_id);
+				return;
+			}
+			glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
 		// Loading and attaching vertex and fragment shader to a program
-		Shader vertexShader(vsh);
+		Shader vertexShader(GL_VERTEX_SHADER, vshSource);
 		glAttachShader(m_id, vertexShader.getId());
-		Shader fragmentShader(fsh);
+		Shader fragmentShader(GL_FRAGMENT_SHADER, fshSource);
 		glAttachShader(m_id, fragmentShader.getId());
 
 		// Linking the shader program
@@ -37,59 +57,35 @@ Shader::Shader(string vsh, string fsh){
 			exit(EXIT_FAILURE);
 		}
 
+		// Cache the linked program for the next start
+		if (formats > 0)
+			saveBinary(cache, key);
+
 		// Use the shader program
-		glUseProgram(m_id);
+		GLState::useProgram(m_id);
 	}
 }
 
-Shader::Shader(string path){
-	if (path.empty())
-		printError("Shader(path)", "Path string is empty.");
+Shader::Shader(GLenum type, const string &source){
+	if (source.empty())
+		printError("Shader(type, source)", "Source string is empty.");
 	else {
-		// Initialize m_isProg = false because this constructor only compiles a shader file
+		// Initialize m_isProg = false because this constructor only compiles a shader
 		m_isProg = false;
 
-		// Loading shader file
-		ifstream file(path);
-
-		// Checking if file exists
-		if (!file) {
-			cerr << "Shader Error:\n" << path << "  not existent.\n";
-			exit(EXIT_FAILURE);
-		}
-
-		// Getting size of file
-		GLint fileSize;
-		file.seekg(0, file.end);
-		fileSize = GLint(file.tellg());
-		file.seekg(0, file.beg);
-
-		// Writing the shader file content into a char array
-		GLchar* buf = new GLchar[fileSize]();
-		file.read(buf, fileSize);
-
-		// Getting type of shader
-		string type = path.substr(path.size() - 4, 4);
+		// The source was loaded by the program's constructor
+		const GLchar *buf = source.c_str();
+		GLint fileSize = GLint(source.size());
 
 		// Generate shader id based on the type (e.g: vertex shader, fragment shader etc.)
-		if (type == ".vsh")
-			m_id = glCreateShader(GL_VERTEX_SHADER);
-		else if (type == ".fsh")
-			m_id = glCreateShader(GL_FRAGMENT_SHADER);
-		else {
-			cerr << "Shader Error:\n" << path << "\nWrong file extension.\n\n";
-			exit(EXIT_FAILURE);
-		}
+		m_id = glCreateShader(type);
 
 		// Uploads shader source code to OpenGL
-		glShaderSource(m_id, 1, (const GLchar**)&buf, (const GLint*)&fileSize);
+		glShaderSource(m_id, 1, &buf, &fileSize);
 
 		// Compiling shader with OpenGL
 		glCompileShader(m_id);
 
-		// Free unused memory
-		delete[] buf;
-
 		// Retrieve and print compilation errors.
 		GLint status, len;
 		glGetShaderiv(m_id, GL_COMPILE_STATUS, &status);
@@ -106,9 +102,111 @@ Shader::Shader(string path){
 	}
 }
 
+string Shader::loadSource(const string &path){
+	// Loading shader file
+	ifstream file(path, ios::binary);
+
+	// Checking if file exists
+	if (!file) {
+		cerr << "Shader Error:\n" << path << "  not existent.\n";
+		exit(EXIT_FAILURE);
+	}
+
+	// Writing the shader file content into a string
+	return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+string Shader::defineSource(const string &source, const vector<string> &defines){
+	if (defines.empty())
+		return source;
+
+	// '#version' must be the first directive, so the defines follow its line
+	size_t pos = 0;
+	if (source.compare(0, 8, "#version") == 0) {
+		pos = source.find('\n');
+		pos = pos == string::npos ? source.size() : pos + 1;
+	}
+	string lines;
+	for (const string &define : defines)
+		lines += "#define " + define + "\n";
+	string result = source;
+	if (pos == source.size() && pos > 0 && source.back() != '\n')
+		lines = "\n" + lines;
+	return result.insert(pos, lines);
+}
+
+unsigned long long Shader::cacheKey(const string &sources){
+	// A binary of another driver or driver version is rejected by glProgramBinary anyway,
+	// but then it would be loaded and rejected on every start
+	string key = sources;
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		const GLubyte *str = glGetString(name);
+		key += '\0';
+		if (str)
+			key += (const char*)str;
+	}
+
+	// 64 bit FNV-1a
+	unsigned long long hash = 14695981039346656037ull;
+	for (unsigned char c : key) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool Shader::loadBinary(const string &cache, unsigned long long key){
+	ifstream file(cache, ios::binary);
+	if (!file)
+		return false;
+
+	// Header: key, binary format and length of the binary
+	unsigned long long fileKey = 0;
+	GLenum format = 0;
+	GLint length = 0;
+	file.read((char*)&fileKey, sizeof(fileKey));
+	file.read((char*)&format, sizeof(format));
+	file.read((char*)&length, sizeof(length));
+	if (!file || fileKey != key || length <= 0)
+		return false;
+
+	string binary(length, '\0');
+	if (!file.read(&binary[0], length))
+		return false;
+
+	// The driver may still reject the binary, then the program stays unlinked and is compiled
+	glProgramBinary(m_id, format, binary.data(), length);
+	GLint status = GL_FALSE;
+	glGetProgramiv(m_id, GL_LINK_STATUS, &status);
+	checkGLError("Shader::loadBinary(..)");
+	return status == GL_TRUE;
+}
+
+void Shader::saveBinary(const string &cache, unsigned long long key)const{
+	GLint length = 0;
+	glGetProgramiv(m_id, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	string binary(length, '\0');
+	GLenum format = 0;
+	glGetProgramBinary(m_id, length, &length, &format, &binary[0]);
+	checkGLError("Shader::saveBinary(..) -> glGetProgramBinary()");
+
+	ofstream file(cache, ios::binary | ios::trunc);
+	if (!file) {
+		printError("Shader::saveBinary(..)", "Cache file " + cache + " could not be written.");
+		return;
+	}
+	file.write((const char*)&key, sizeof(key));
+	file.write((const char*)&format, sizeof(format));
+	file.write((const char*)&length, sizeof(length));
+	file.write(binary.data(), length);
+}
+
 Shader::~Shader(){
 	if (m_isProg)
-		glDeleteProgram(m_id);
+		GLState::deleteProgram(m_id);
 	else
 		glDeleteShader(m_id);
 }
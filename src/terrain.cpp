@@ -1,9 +1,16 @@
 #include "terrain.h"
 
-Terrain::Terrain(Noise &n, float sW, float sD, unsigned vD, unsigned nmD, const GLuint progId)
-	: m_surfaceWidth(sW), m_surfaceDepth(sD), m_min(0), m_max(0), m_vertexDetail(vD),
-	  m_vpr(128*vD), m_vpc(128*vD), m_programId(progId)
+Terrain::Terrain(Noise &n, float sW, float sD, unsigned vD, unsigned nmD, const string &vsh, const string &fsh, const string &cache)
+	: m_surfaceWidth(sW), m_surfaceDepth(sD), m_min(0), m_max(0), m_seamlessTexEnabled(true), m_stoneDetailEnabled(false),
+	  m_vertexDetail(vD), m_vpr(128*vD + 1), m_vpc(128*vD + 1), m_vsh(vsh), m_fsh(fsh), m_cache(cache), m_variant(0),
+	  m_heightFormat(HeightFormat::Float),
+	  m_normalFormat(NormalFormat::Float), m_vertexSource(VertexSource::Streams), m_vaoId(0), m_pulledVertexCount(0), m_maxError(0.0f),
+	  m_adaptiveDrawn(false), m_elementOrder(ElementOrder::Rows), m_pulledIndexedDrawn(false), m_eboId(0),
+	  m_pulledElementCount(0)
 {
+	for (Shader *&variant : m_variants)
+		variant = nullptr;
+
 	if (sW <= 0.0f || sD <= 0.0f)
 		printCriticalError("Terrain(..)", "Width or depth of the surface is less then or equal to 0.0");
 	else if (vD == 0)
@@ -13,13 +20,13 @@ Terrain::Terrain(Noise &n, float sW, float sD, unsigned vD, unsigned nmD, const
 	else {
 		// Initialize normal map detail member
 		m_normalMapDetail = nmD;
-		m_normalMapWidth = 256 * nmD;
-		m_normalMapHeight = 256 * nmD;
+		m_normalMapWidth = 256 * nmD + 1;
+		m_normalMapHeight = 256 * nmD + 1;
 
 		// Allocate memory
 		m_elements = new vector<GLuint>();
-		m_vertices = new vector<Vertex>();
-		m_normalMap = new vector<vec3>();
+		m_grid = new vector<vec2>();
+		m_heights = new vector<GLubyte>();
 		m_seamlessMap = new vector<vec3>();
 
 		// Copy noise reference
@@ -28,265 +35,705 @@ Terrain::Terrain(Noise &n, float sW, float sD, unsigned vD, unsigned nmD, const
 		// Initialize other member
 		m_brightness = 1.0f;
 
-		// Calculate vertices and element list.
-		calculateVertices();
+		// Calculate grid and element list. The heights are calculated directly into the height stream.
+		calculateGrid();
 		calculateElements();
 
+		// Compile the variant that shows the seamless noise texture at start
+		selectVariant();
+
 		// Set and upload terrain brightness
 		setBrightness(1.0f);
-
-		// Upload that the seamless noise texture is shown at start
-		setSeamlessTexEnabled(true);
 	}
 }
 
 Terrain::~Terrain()
 {
-	m_vertices->clear();
-	delete m_vertices;
+	m_grid->clear();
+	delete m_grid;
 	m_elements->clear();
 	delete m_elements;
 	m_seamlessMap->clear();
 	delete m_seamlessMap;
-	m_normalMap->clear();
-	delete m_normalMap;
+	delete m_heights;
+	GLState::deleteBuffers(1, &m_eboId);
+	GLState::deleteVertexArrays(1, &m_vaoId);
+	for (Shader *variant : m_variants)
+		delete variant;
 }
 
-void Terrain::calculateVertices(){
+void Terrain::calculateGrid(){
 	// Freeing and / or allocating memory
-	if (m_vertices->size() > 0) {
-		m_vertices->clear();
-		vector<Vertex> s;
-		m_vertices->swap(s);
+	if (m_grid->size() > 0) {
+		m_grid->clear();
+		vector<vec2> s;
+		m_grid->swap(s);
 	}
-	m_vertices->resize(m_vpr * m_vpc);
+	m_grid->resize(m_vpr * m_vpc);
 
-	// Declaration
-	m_min = m_noise->n2_layered(0, 0);
-	m_max = m_noise->n2_layered(0, 0);
-	float addWidth = m_surfaceWidth / float(m_vpr);
-	float subDepth = m_surfaceDepth / float(m_vpc);
-	float surfaceMidX = m_surfaceWidth / 2.0f;
-	float surfaceMidZ = m_surfaceDepth / 2.0f;
+	calculateGrid(m_grid->data());
+}
+
+void Terrain::calculateGrid(vec2 *target)const{
 	float textureCoordAddX = 1.0f / (m_vpr - 1.0f);
 	float textureCoordAddY = 1.0f / (m_vpc - 1.0f);
 
-	// Calculate Positions
+	// Texture coordinates. The positions on x- and z-axis are derived from them in the vertex shader.
 	int index = 0;
-	for (unsigned int z = 0; z < m_vpc; z++){
-		for (unsigned int x = 0; x < m_vpr; x++){
+	for (unsigned int z = 0; z < m_vpc; z++)
+		for (unsigned int x = 0; x < m_vpr; x++)
+			target[index++] = vec2(x*textureCoordAddX, z*textureCoordAddY);
+}
 
-			// Calculate noiseValue
-			float noiseValue = (m_noise->n2_layered(x * addWidth, z * subDepth));
+void Terrain::calculateHeights(void *target, bool keep){
+	// Declaration
+	m_min = FLT_MAX;
+	m_max = -FLT_MAX;
+	float addWidth = m_surfaceWidth / float(m_vpr);
+	float subDepth = m_surfaceDepth / float(m_vpc);
 
-			// Vertex positions and texture coordinate
-			m_vertices->at(index).pos = vec3(x * addWidth - surfaceMidX, noiseValue, z * (-subDepth) + surfaceMidZ);
-            m_vertices->at(index).texCoord = vec2(x*textureCoordAddX, z*textureCoordAddY);
+	// Quantization maps [-amplitude, amplitude] to [0, 65535]
+	float amplitude = m_noise->getAmplitude();
+	float quantize = 65535.0f / (2.0f * amplitude);
 
-			// Calculate minimum and maximum noise value
-			if (noiseValue > m_max)
-				m_max = noiseValue;
-			if (noiseValue < m_min)
-				m_min = noiseValue;
+	// The kept heights are only allocated again when their size changed, and freed when they are not needed
+	if (keep)
+		m_heights->resize(m_vpr * m_vpc * getHeightSize());
+	else {
+		vector<GLubyte> s;
+		m_heights->swap(s);
+	}
+	GLfloat *floatTarget = (GLfloat*)target;
+	GLushort *unormTarget = (GLushort*)target;
+	GLfloat *floatKept = keep ? (GLfloat*)m_heights->data() : nullptr;
+	GLushort *unormKept = keep ? (GLushort*)m_heights->data() : nullptr;
+	mutex rangeMutex;
+
+	// Calculate heights in bands of rows on all cores. The target is only written, and each band
+	// in one go, because it may be mapped buffer memory which is very slow to read from. The
+	// heights are shifted by the lowest point in the vertex shader, so that the terrain's lowest
+	// point is always y = 0.
+	forEachTile(m_vpr, m_vpc, m_vpr, Heightfield::TileSize, [&](unsigned x0, unsigned z0, unsigned x1, unsigned z1) {
+		float bandMin = FLT_MAX;
+		float bandMax = -FLT_MAX;
+		for (unsigned int z = z0; z < z1; z++){
+			for (unsigned int x = x0; x < x1; x++){
+				unsigned index = z * m_vpr + x;
+
+				// Calculate noiseValue
+				float noiseValue = (m_noise->n2_layered(x * addWidth, z * subDepth));
+
+				// Write the height in the format of the height stream
+				if (m_heightFormat == HeightFormat::Unorm16) {
+					GLushort height = GLushort(clamp((noiseValue + amplitude) * quantize + 0.5f, 0.0f, 65535.0f));
+					if (unormTarget)
+						unormTarget[index] = height;
+					if (unormKept)
+						unormKept[index] = height;
+				}
+				else {
+					if (floatTarget)
+						floatTarget[index] = noiseValue;
+					if (floatKept)
+						floatKept[index] = noiseValue;
+				}
+
+				// Calculate minimum and maximum noise value
+				bandMin = std::min(bandMin, noiseValue);
+				bandMax = std::max(bandMax, noiseValue);
+			}
+		}
+
+		// Reduce the minimum and maximum of all bands
+		lock_guard<mutex> lock(rangeMutex);
+		m_min = std::min(m_min, bandMin);
+		m_max = std::max(m_max, bandMax);
+	});
+}
 
-			// Increase index
-            index++;
+void Terrain::uploadSurface(){
+	checkGLError("Terrain::uploadSurface() -> Error occured before this call.");
+
+	// Extent of the grid and its mid point. See calculateHeights for the positions the noise is sampled at.
+	setUniform("gridSize", m_surfaceWidth * (m_vpr - 1) / float(m_vpr), m_surfaceDepth * (m_vpc - 1) / float(m_vpc));
+	setUniform("surfaceMid", m_surfaceWidth / 2.0f, m_surfaceDepth / 2.0f);
+
+	// Scale and offset that turn the value of the height stream back into the noise value
+	float amplitude = m_noise->getAmplitude();
+	if (m_heightFormat == HeightFormat::Unorm16) {
+		setUniform("heightScale", 2.0f * amplitude);
+		setUniform("heightOffset", -amplitude);
+	}
+	else {
+		setUniform("heightScale", 1.0f);
+		setUniform("heightOffset", 0.0f);
+	}
+
+	// Grid resolution for the vertices that are derived from gl_VertexID
+	setUniform("vertexPulling", GLint(m_vertexSource == VertexSource::HeightTexture));
+	setUniform("gridResolution", GLint(m_vpr), GLint(m_vpc));
+	m_pulledVertexCount = getPulledVertexCount();
+
+	// With elements the pulled vertices are indexed by the grid position
+	m_adaptiveDrawn = m_maxError > 0.0f;
+	m_pulledIndexedDrawn = getPulledIndexed();
+	setUniform("indexedPulling", GLint(m_pulledIndexedDrawn));
+
+	// Lowest and highest point
+	setUniform("maxHeight", m_max - m_min);
+	setUniform("minHeight", m_min);
+	checkGLError("Terrain::uploadSurface() -> Upload surface and height range");
+}
+
+void Terrain::streamNormalMap(const function<void(unsigned, unsigned, const void*)> &upload, const void *heights)const{
+	// Only one band of normals is in memory at a time, and one packed band, unless no packing is needed.
+	// A band may take up to 3 more rows, see below.
+	const unsigned maxRows = NormalBandRows + 3;
+	vector<vec3> band(m_normalMapWidth * maxRows);
+	vector<GLubyte> packed;
+	if (m_normalFormat == NormalFormat::Rgtc2)
+		packed.resize(Texture::compressedSize(getNormalCompression(), m_normalMapWidth, maxRows));
+	else if (m_normalFormat != NormalFormat::Float)
+		packed.resize(band.size() * getNormalSize());
+
+	for (unsigned z0 = 0, z1 = 0; z0 < m_normalMapHeight; z0 = z1) {
+		// The rows of a block compressed upload need to be a multiple of 4 unless they end at the bottom
+		// of the texture. So a last band of less than 4 rows (e.g. the single row of 256 * detail + 1)
+		// is merged into the band before it.
+		z1 = std::min(z0 + NormalBandRows, m_normalMapHeight);
+		if (m_normalMapHeight - z1 < 4)
+			z1 = m_normalMapHeight;
+		calculateNormalBand(z0, z1, band.data(), heights);
+		if (packed.empty())
+			upload(z0, z1 - z0, band.data());
+		else {
+			if (m_normalFormat == NormalFormat::Rgtc2)
+				compressNormals(band.data(), m_normalMapWidth, z1 - z0, packed.data());
+			else
+				packNormals(band.data(), (z1 - z0) * m_normalMapWidth, packed.data());
+			upload(z0, z1 - z0, packed.data());
 		}
 	}
+}
 
-	// Recalculate height values so that the terrain's lowest point is always y = 0;
-	index = 0;
-	for (unsigned int z = 0; z < m_vpc; z++) {
-		for (unsigned int x = 0; x < m_vpr; x++) {
-			m_vertices->at(index).pos.y -= m_min;
-			index++;
+void Terrain::packNormals(const vec3 *normals, unsigned count, void *target)const{
+	GLshort *snormTarget = (GLshort*)target;
+	GLubyte *unormTarget = (GLubyte*)target;
+
+	switch (m_normalFormat) {
+	case NormalFormat::Float:
+		memcpy(target, normals, count * sizeof(vec3));
+		break;
+	case NormalFormat::Snorm16:
+		// Only x and z, the y component is reconstructed in the fragment shader
+		for (unsigned i = 0; i < count; i++) {
+			snormTarget[2 * i] = GLshort(std::round(clamp(normals[i].x, -1.0f, 1.0f) * 32767.0f));
+			snormTarget[2 * i + 1] = GLshort(std::round(clamp(normals[i].z, -1.0f, 1.0f) * 32767.0f));
+		}
+		break;
+	case NormalFormat::Unorm8:
+		// Same with [-1, 1] mapped to [0, 255]
+		for (unsigned i = 0; i < count; i++) {
+			unormTarget[2 * i] = GLubyte(clamp(normals[i].x * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f + 0.5f);
+			unormTarget[2 * i + 1] = GLubyte(clamp(normals[i].z * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f + 0.5f);
 		}
+		break;
+	case NormalFormat::Octahedral:
+		// Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper one
+		for (unsigned i = 0; i < count; i++) {
+			vec3 n = normals[i] / (std::abs(normals[i].x) + std::abs(normals[i].y) + std::abs(normals[i].z));
+			vec2 e(n.x, n.z);
+			if (n.y < 0.0f)
+				e = vec2((1.0f - std::abs(n.z)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+					(1.0f - std::abs(n.x)) * (n.z >= 0.0f ? 1.0f : -1.0f));
+			snormTarget[2 * i] = GLshort(std::round(clamp(e.x, -1.0f, 1.0f) * 32767.0f));
+			snormTarget[2 * i + 1] = GLshort(std::round(clamp(e.y, -1.0f, 1.0f) * 32767.0f));
+		}
+		break;
+	case NormalFormat::Rgtc2:
+		printError("Terrain::packNormals(..)", "Block compressed normals need to be compressed with compressNormals(..).");
+		break;
 	}
+}
 
-	checkGLError("Terrain::calculateVertices(..) -> Upload new highpoint. Error occured before this call.");
-	const GLuint maxLoc = glGetUniformLocation(m_programId, "max");
-	glUniform1f(maxLoc, m_max - m_min);
-	checkGLError("Terrain::calculateVertices(..) -> Upload new highpoint");
+void Terrain::compressNormals(const vec3 *normals, unsigned width, unsigned height, GLubyte *target){
+	unsigned blocksX = (width + 3) / 4;
+	unsigned blocksY = (height + 3) / 4;
+
+	// Rows of blocks on all cores. Each block holds the RGTC1 block of x, followed by the one of z.
+	forEachTile(blocksX, blocksY, blocksX, 1, [&](unsigned bx0, unsigned by0, unsigned bx1, unsigned by1) {
+		float x[16], z[16];
+		for (unsigned by = by0; by < by1; by++) {
+			for (unsigned bx = bx0; bx < bx1; bx++) {
+				// Gather the block, repeating the last row and column for incomplete blocks
+				for (unsigned i = 0; i < 16; i++) {
+					unsigned px = std::min(bx * 4 + i % 4, width - 1);
+					unsigned pz = std::min(by * 4 + i / 4, height - 1);
+					const vec3 &n = normals[pz * width + px];
+					x[i] = clamp(n.x, -1.0f, 1.0f) * 127.0f;
+					z[i] = clamp(n.z, -1.0f, 1.0f) * 127.0f;
+				}
+				GLubyte *block = target + (by * blocksX + bx) * 16;
+				compressChannel(x, block);
+				compressChannel(z, block + 8);
+			}
+		}
+	});
 }
 
-void Terrain::calculateNormalMap(){
-	// Memory allcoation for noise values
-	vector<float> noise_values;
-	noise_values.reserve(m_normalMapWidth * m_normalMapHeight);
+void Terrain::compressChannel(const float *values, GLubyte *block){
+	float low = values[0], high = values[0];
+	for (unsigned i = 1; i < 16; i++) {
+		low = std::min(low, values[i]);
+		high = std::max(high, values[i]);
+	}
 
-	// Freeing normal map and / or allocating memory for it
-	if (m_normalMap->size() > 0) {
-		m_normalMap->clear();
-		vector<vec3> s;
-		m_normalMap->swap(s);
+	// With red0 > red1 the block interpolates 6 values between the end points
+	GLbyte red0 = GLbyte(std::round(high));
+	GLbyte red1 = GLbyte(std::round(low));
+	block[0] = GLubyte(red0);
+	block[1] = GLubyte(red1);
+
+	// 3 bit index per value. Index 0 is red0, 1 is red1 and 2 - 7 run from red0 to red1.
+	unsigned long long indices = 0;
+	if (red0 > red1) {
+		float scale = 7.0f / (red0 - red1);
+		for (unsigned i = 0; i < 16; i++) {
+			int step = clamp(int(std::round((values[i] - red1) * scale)), 0, 7);
+			unsigned long long index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+			indices |= index << (3 * i);
+		}
 	}
-    m_normalMap->reserve(m_normalMapWidth * m_normalMapHeight);
+	for (unsigned i = 0; i < 6; i++)
+		block[2 + i] = GLubyte(indices >> (8 * i));
+}
+
+void Terrain::compressNormalMipmaps(const vector<vec3> &normals, unsigned width, unsigned height, unsigned levelCount,
+	vector<vector<GLubyte>> &levels){
+	levels.resize(levelCount);
+	vector<vec3> level, next;
+	const vec3 *current = normals.data();
+
+	for (unsigned i = 0; i < levelCount; i++) {
+		levels[i].resize(Texture::compressedSize(GL_COMPRESSED_SIGNED_RG_RGTC2, width, height));
+		compressNormals(current, width, height, levels[i].data());
+		if (i + 1 == levelCount)
+			break;
+
+		// Mean of 2x2 normals, renormalized
+		unsigned nextWidth = std::max(width / 2, 1u);
+		unsigned nextHeight = std::max(height / 2, 1u);
+		next.resize(nextWidth * nextHeight);
+		for (unsigned z = 0; z < nextHeight; z++) {
+			for (unsigned x = 0; x < nextWidth; x++) {
+				unsigned x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+				unsigned z0 = std::min(2 * z, height - 1), z1 = std::min(2 * z + 1, height - 1);
+				next[z * nextWidth + x] = normalize(current[z0 * width + x0] + current[z0 * width + x1] +
+					current[z1 * width + x0] + current[z1 * width + x1]);
+			}
+		}
+		level.swap(next);
+		current = level.data();
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
 
+void Terrain::calculateNormalBand(unsigned bandZ0, unsigned bandZ1, vec3 *target, const void *heights)const{
 	float addWidth = m_surfaceWidth / m_vpr;
 	float subDepth = m_surfaceDepth / m_vpc;
 
 	// Both sides minus 1 because of we're running from 0-(max-1)
 	float widthDivisor = float(m_normalMapWidth - 1) / (m_vpr - 1);
 	float heightDivisor = float(m_normalMapHeight - 1) / (m_vpc - 1);
-
-	if (m_normalMapWidth != m_vpr || m_normalMapHeight != m_vpc) {
-		for (unsigned int y = 0; y < m_normalMapHeight; y++)
-			for (unsigned int x = 0; x < m_normalMapWidth; x++)
-				noise_values.push_back((m_noise->n2_layered((x / widthDivisor)*addWidth, (y / heightDivisor) *subDepth)));
-	}
-	else {
-		int index = 0;
-		for (unsigned int y = 0; y < m_normalMapHeight; y++){
-			for (unsigned int x = 0; x < m_normalMapWidth; x++) {
-				noise_values.push_back(m_vertices->at(index).pos.y);
-				index++;
-			}
+	float scaleX = addWidth / widthDivisor;
+	float scaleZ = subDepth / heightDivisor;
+
+	// Pixel x lies on vertex x * (vpr - 1) / (width - 1), if that is a whole number. The heights of
+	// these pixels are read from the height stream in its format instead of evaluating the noise again.
+	unsigned gridX = m_vpr - 1, pixelX = m_normalMapWidth - 1;
+	unsigned gridZ = m_vpc - 1, pixelZ = m_normalMapHeight - 1;
+	float amplitude = m_noise->getAmplitude();
+	float dequantize = 2.0f * amplitude / 65535.0f;
+	auto sample = [&](unsigned x, unsigned z) {
+		if (heights && (x * gridX) % pixelX == 0 && (z * gridZ) % pixelZ == 0) {
+			unsigned index = (z * gridZ / pixelZ) * m_vpr + x * gridX / pixelX;
+			if (m_heightFormat == HeightFormat::Unorm16)
+				return ((const GLushort*)heights)[index] * dequantize - amplitude;
+			return ((const GLfloat*)heights)[index];
 		}
-	}
-
-	// Calculate Normals
-	int index = 0;
-	bool left_tmp, bottom_tmp, right_tmp, top_tmp;
-	vec3 left(0.0,0.0,0.0), bottom(0.0, 0.0, 0.0), right(0.0, 0.0, 0.0), top(0.0, 0.0, 0.0);
-	for (unsigned int z = 0; z < m_normalMapHeight; z++){
-		for (unsigned int x = 0; x < m_normalMapWidth; x++){
-			left_tmp = true; bottom_tmp = true; right_tmp = true; top_tmp = true;
-			vec3 current = { (x / widthDivisor)*addWidth, noise_values[index], (z / heightDivisor)*subDepth };
-			vec3 n1(0.0, 0.0, 0.0), n2(0.0, 0.0, 0.0), n3(0.0, 0.0, 0.0), n4(0.0, 0.0, 0.0);
-
-			// Get all 4 surrounding vertices
-			if (x > 0)
-				left = vec3(((x - 1) / widthDivisor)* addWidth, noise_values[index - 1], (z / heightDivisor)*(subDepth));
-			else
-				left_tmp = false;
-			if (z > 0)
-				bottom = vec3((x / widthDivisor)*addWidth, noise_values[index - m_normalMapWidth], ((z - 1) / heightDivisor)*(subDepth));
-			else
-				bottom_tmp = false;
-			if (x < (m_normalMapWidth - 1))
-				right = vec3(((x + 1) / widthDivisor)*addWidth, noise_values[index + 1], (z / heightDivisor)*(subDepth));
-			else
-				right_tmp = false;
-			if (z < (m_normalMapHeight - 1))
-				top = vec3((x / widthDivisor)*addWidth, noise_values[index + m_normalMapWidth], ((z + 1) / heightDivisor)*(subDepth));
-			else
-				top_tmp = false;
-
-			if (left_tmp && bottom_tmp)
-				n1 = -cross(left - current, bottom - current);
-			if (bottom_tmp && right_tmp)
-				n2 = -cross(bottom - current, right - current);
-			if (right_tmp && top_tmp)
-				n3 = -cross(right - current, top - current);
-			if (top_tmp && left_tmp)
-				n4 = -cross(top - current, left - current);
-
-			// Getting the average normal
-			vec3 normal = normalize(n1 + n2 + n3 + n4);
-
-			// Pushing normal
-			m_normalMap->push_back(normal);
-
-			// Increase index
-			index++;
+		return m_noise->n2_layered((x / widthDivisor)*addWidth, (z / heightDivisor)*subDepth);
+	};
+
+	// Each tile calculates its noise values including a halo of one pixel and writes its normals
+	// right away, while the noise values are still in the cache. The tiles run on all cores.
+	forEachTile(m_normalMapWidth, bandZ1 - bandZ0, Heightfield::TileSize, Heightfield::TileSize,
+		[&](unsigned x0, unsigned z0, unsigned x1, unsigned z1) {
+		z0 += bandZ0;
+		z1 += bandZ0;
+
+		// The halo only reaches as far as the normal map
+		unsigned haloX0 = x0 > 0 ? x0 - 1 : 0;
+		unsigned haloZ0 = z0 > 0 ? z0 - 1 : 0;
+		unsigned haloX1 = std::min(x1 + 1, m_normalMapWidth);
+		unsigned haloZ1 = std::min(z1 + 1, m_normalMapHeight);
+		unsigned stride = haloX1 - haloX0;
+
+		// Noise values of the tile, as far as they are not shared with the vertex grid
+		float noise_values[(Heightfield::TileSize + 2) * (Heightfield::TileSize + 2)];
+		for (unsigned int y = haloZ0; y < haloZ1; y++)
+			for (unsigned int x = haloX0; x < haloX1; x++)
+				noise_values[(y - haloZ0) * stride + x - haloX0] = sample(x, y);
+
+		// Calculate Normals
+		for (unsigned int z = z0; z < z1; z++){
+			for (unsigned int x = x0; x < x1; x++){
+				const float *current = &noise_values[(z - haloZ0) * stride + x - haloX0];
+				target[(z - bandZ0) * m_normalMapWidth + x] = calculateNormal(*current,
+					x > 0 ? current - 1 : nullptr,
+					z > 0 ? current - stride : nullptr,
+					x < m_normalMapWidth - 1 ? current + 1 : nullptr,
+					z < m_normalMapHeight - 1 ? current + stride : nullptr,
+					scaleX, scaleZ);
+			}
 		}
-	}
+	});
 }
 
 void Terrain::calculateSeamlessMap(const Noise &n, unsigned resolution){
-	// See comments in function "calculateNormalMap" as reference for this code block
-	vector<float> noise_values;
-	noise_values.reserve(resolution * resolution);
+	// Freeing the seamless map and / or allocating memory for it
+	Heightfield noise_values(resolution, resolution);
 
 	if (m_seamlessMap->size() > 0) {
 		m_seamlessMap->clear();
 		vector<vec3> s;
 		m_seamlessMap->swap(s);
 	}
-    m_seamlessMap->reserve(resolution * resolution);
-
-	for (unsigned int y = 0; y < resolution; y++)
-		for (unsigned int x = 0; x < resolution; x++)
-			noise_values.push_back(n.n2_seamless_layered(float(x), float(y)));
-
-	// Calculate Normals
-	int index = 0;
-	bool left_tmp, bottom_tmp, right_tmp, top_tmp;
-	vec3 left(0.0, 0.0, 0.0), bottom(0.0, 0.0, 0.0), right(0.0, 0.0, 0.0), top(0.0, 0.0, 0.0);
-	for (unsigned int z = 0; z < resolution; z++) {
-		for (unsigned int x = 0; x < resolution; x++) {
-			left_tmp = true; bottom_tmp = true; right_tmp = true; top_tmp = true;
-			vec3 current = { x, noise_values[index], z };
-			vec3 n1(0.0, 0.0, 0.0), n2(0.0, 0.0, 0.0), n3(0.0, 0.0, 0.0), n4(0.0, 0.0, 0.0);
-
-			if (x > 0)
-				left = vec3((x - 1), noise_values[index - 1], z);
-			else
-				left_tmp = false;
-			if (z > 0)
-				bottom = vec3(x, noise_values[index - resolution], (z - 1));
-			else
-				bottom_tmp = false;
-			if (x < (resolution - 1))
-				right = vec3((x + 1), noise_values[index + 1], z);
-			else
-				right_tmp = false;
-			if (z < (resolution - 1))
-				top = vec3(x, noise_values[index + resolution], (z + 1));
-			else
-				top_tmp = false;
+    m_seamlessMap->resize(resolution * resolution);
+
+	// The noise values of every tile on all cores, then the normals, which wrap around the
+	// borders, so that the texture also repeats without a seam in its lighting
+	forEachTile(resolution, resolution, Heightfield::TileSize, Heightfield::TileSize,
+		[&](unsigned x0, unsigned y0, unsigned x1, unsigned y1) {
+		for (unsigned int y = y0; y < y1; y++)
+			for (unsigned int x = x0; x < x1; x++)
+				noise_values.at(x, y) = n.n2_seamless_layered(float(x), float(y));
+	});
+
+	calculateNormals(noise_values, 1.0f, 1.0f, m_seamlessMap->data(), true);
+}
 
-			if (left_tmp && bottom_tmp)
-				n1 = -cross(left - current, bottom - current);
-			if (bottom_tmp && right_tmp)
-				n2 = -cross(bottom - current, right - current);
-			if (right_tmp && top_tmp)
-				n3 = -cross(right - current, top - current);
-			if (top_tmp && left_tmp)
-				n4 = -cross(top - current, left - current);
+void Terrain::calculateNormals(const Heightfield &heights, float scaleX, float scaleZ, vec3 *target, bool wrap){
+	unsigned width = heights.getWidth();
+	unsigned height = heights.getHeight();
+
+	// Tile by tile on all cores, so that all neighbours are still in the cache
+	forEachTile(width, height, Heightfield::TileSize, Heightfield::TileSize,
+		[&](unsigned x0, unsigned z0, unsigned x1, unsigned z1) {
+		for (unsigned int z = z0; z < z1; z++){
+			for (unsigned int x = x0; x < x1; x++){
+				// Neighbours behind the border are taken from the other side when wrapping
+				bool hasLeft = wrap || x > 0, hasBottom = wrap || z > 0;
+				bool hasRight = wrap || x < width - 1, hasTop = wrap || z < height - 1;
+				float left = hasLeft ? heights.at((x + width - 1) % width, z) : 0.0f;
+				float bottom = hasBottom ? heights.at(x, (z + height - 1) % height) : 0.0f;
+				float right = hasRight ? heights.at((x + 1) % width, z) : 0.0f;
+				float top = hasTop ? heights.at(x, (z + 1) % height) : 0.0f;
+
+				// The normal map itself stays row by row for the upload
+				target[z * width + x] = calculateNormal(heights.at(x, z),
+					hasLeft ? &left : nullptr, hasBottom ? &bottom : nullptr,
+					hasRight ? &right : nullptr, hasTop ? &top : nullptr, scaleX, scaleZ);
+			}
+		}
+	});
+}
 
-			vec3 normal = normalize(n1 + n2 + n3 + n4);
-			m_seamlessMap->push_back(normal);
+vec3 Terrain::calculateNormal(float current, const float *left, const float *bottom, const float *right, const float *top,
+	float scaleX, float scaleZ){
+	vec3 n1(0.0, 0.0, 0.0), n2(0.0, 0.0, 0.0), n3(0.0, 0.0, 0.0), n4(0.0, 0.0, 0.0);
+
+	// All 4 surrounding vertices, relative to the current one
+	vec3 l(-scaleX, left ? *left - current : 0.0f, 0.0f);
+	vec3 b(0.0f, bottom ? *bottom - current : 0.0f, -scaleZ);
+	vec3 r(scaleX, right ? *right - current : 0.0f, 0.0f);
+	vec3 t(0.0f, top ? *top - current : 0.0f, scaleZ);
+
+	if (left && bottom)
+		n1 = -cross(l, b);
+	if (bottom && right)
+		n2 = -cross(b, r);
+	if (right && top)
+		n3 = -cross(r, t);
+	if (top && left)
+		n4 = -cross(t, l);
+
+	// Getting the average normal
+	return normalize(n1 + n2 + n3 + n4);
+}
 
-			index++;
-		}
-	}
+void Terrain::forEachTile(unsigned width, unsigned height, unsigned tileWidth, unsigned tileHeight,
+	const function<void(unsigned, unsigned, unsigned, unsigned)> &work){
+	unsigned tilesX = (width + tileWidth - 1) / tileWidth;
+	unsigned tilesY = (height + tileHeight - 1) / tileHeight;
+
+	// Every thread of the pool takes the next tile until all are done
+	WorkerPool::run(tilesX * tilesY, [&](unsigned tile) {
+		unsigned x0 = (tile % tilesX) * tileWidth;
+		unsigned y0 = (tile / tilesX) * tileHeight;
+		work(x0, y0, std::min(x0 + tileWidth, width), std::min(y0 + tileHeight, height));
+	});
 }
 
 void Terrain::calculateElements(){
-	// Calculation of the number of elements needed for the vertices
-    int elementSize = ((2 * m_vpr) * (m_vpc - 2)) + (2 * m_vpr) - (m_vpc - 2);
-
 	// Memory de-/allcotion
 	if (m_elements->size() > 0) {
 		m_elements->clear();
 		vector<GLuint> s;
 		m_elements->swap(s);
 	}
-    m_elements->reserve(elementSize);
-
-	// Calculate actual elements
-	GLuint bot = 0;
-	GLuint top = m_vpr;
-	for (unsigned int y = 0; y < m_vpc - 1; y++){
-		for (unsigned int x = 0; x < m_vpr; x++){
-			m_elements->push_back(bot++);
-			m_elements->push_back(top++);
+	m_elements->resize(getElementCount());
+
+	calculateElements(m_elements->data());
+}
+
+void Terrain::calculateElements(GLuint *target)const{
+	// A stripe over the whole width for the order Rows
+	unsigned stripeWidth = m_vpr - 1;
+	if (m_elementOrder == ElementOrder::Blocks)
+		stripeWidth = BlockSize;
+
+	// Calculate actual elements, one stripe after the other
+	unsigned index = 0;
+	for (unsigned int stripe = 0; stripe < m_vpr - 1; stripe += stripeWidth){
+		for (unsigned int y = 0; y < m_vpc - 1; y++){
+			GLuint bot = y * m_vpr + stripe;
+			GLuint top = bot + m_vpr;
+			for (unsigned int x = 0; x <= stripeWidth; x++){
+				target[index++] = bot++;
+				target[index++] = top++;
+			}
+			target[index++] = ~0;
+		}
+	}
+}
+
+float Terrain::calculateACMR(const GLuint *elements, unsigned count, GLenum mode, unsigned cacheSize){
+	// FIFO cache as a ring buffer of vertex indices
+	vector<GLuint> cache(cacheSize, ~0u);
+	unsigned next = 0, misses = 0, triangles = 0, stripLength = 0;
+
+	for (unsigned i = 0; i < count; i++) {
+		GLuint e = elements[i];
+		if (e == ~0u) {
+			stripLength = 0;
+			continue;
+		}
+
+		// Every index of a strip after the second one adds a triangle
+		if (mode == GL_TRIANGLES) {
+			if (i % 3 == 2)
+				triangles++;
+		}
+		else if (++stripLength >= 3)
+			triangles++;
+
+		if (find(cache.begin(), cache.end(), e) == cache.end()) {
+			cache[next] = e;
+			next = (next + 1) % cacheSize;
+			misses++;
 		}
-		m_elements->push_back(~0);
 	}
-	m_elementsSize = elementSize;
+	return triangles > 0 ? float(misses) / triangles : 0.0f;
+}
+
+void Terrain::setElementOrder(ElementOrder order){
+	m_elementOrder = order;
+	if (!m_elements->empty())
+		calculateElements();
+}
+
+void Terrain::calculateAdaptiveElements(const void *heights, vector<GLuint> &target)const{
+	// Corner coordinates of all triangles of a chunk, in the order of the binary tree of triangle
+	// splits. Two top level triangles, each split in two halves down to a leg length of one cell.
+	// Built once by the thread safe initialization of the static, the loader may triangulate concurrently.
+	const unsigned numTriangles = ChunkSize * ChunkSize * 2 - 2;
+	const unsigned numParentTriangles = numTriangles - ChunkSize * ChunkSize;
+	static const vector<unsigned short> coords = [numTriangles]() {
+		vector<unsigned short> coords(numTriangles * 4);
+		for (unsigned i = 0; i < numTriangles; i++) {
+			unsigned id = i + 2;
+			unsigned ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+			if (id & 1) {
+				bx = by = cx = ChunkSize;
+			}
+			else {
+				ax = ay = cy = ChunkSize;
+			}
+			while ((id >>= 1) > 1) {
+				unsigned mx = (ax + bx) >> 1;
+				unsigned my = (ay + by) >> 1;
+				if (id & 1) {
+					bx = ax; by = ay;
+					ax = cx; ay = cy;
+				}
+				else {
+					ax = bx; ay = by;
+					bx = cx; by = cy;
+				}
+				cx = mx; cy = my;
+			}
+			coords[i * 4 + 0] = ax;
+			coords[i * 4 + 1] = ay;
+			coords[i * 4 + 2] = bx;
+			coords[i * 4 + 3] = by;
+		}
+		return coords;
+	}();
+
+	unsigned chunksX = (m_vpr - 1) / ChunkSize;
+	unsigned chunksZ = (m_vpc - 1) / ChunkSize;
+	vector<vector<GLuint>> chunkElements(chunksX * chunksZ);
+
+	// Triangulate the chunks on all cores
+	forEachTile(m_vpr - 1, m_vpc - 1, ChunkSize, ChunkSize, [&](unsigned originX, unsigned originZ, unsigned, unsigned) {
+		const unsigned size = ChunkSize + 1;
+		vector<float> chunkHeights(size * size);
+		vector<float> errors(size * size, 0.0f);
+		vector<unsigned short> stack;
+
+		// Scale and offset that turn 16 bit heights back into noise values
+		float amplitude = m_noise->getAmplitude();
+		float scale = m_heightFormat == HeightFormat::Unorm16 ? 2.0f * amplitude / 65535.0f : 1.0f;
+		float offset = m_heightFormat == HeightFormat::Unorm16 ? -amplitude : 0.0f;
+		unsigned chunk = (originZ / ChunkSize) * chunksX + originX / ChunkSize;
+
+		// Copy heights of the chunk
+		for (unsigned z = 0; z < size; z++) {
+			for (unsigned x = 0; x < size; x++) {
+				unsigned index = (originZ + z) * m_vpr + originX + x;
+				if (m_heightFormat == HeightFormat::Unorm16)
+					chunkHeights[z * size + x] = ((const GLushort*)heights)[index] * scale + offset;
+				else
+					chunkHeights[z * size + x] = ((const GLfloat*)heights)[index];
+			}
+		}
+
+		// Edges shared with another chunk get the highest error, so that both chunks split them fully
+		for (unsigned i = 0; i < size; i++) {
+			if (originX > 0)
+				errors[i * size] = FLT_MAX;
+			if (originX + ChunkSize < m_vpr - 1)
+				errors[i * size + ChunkSize] = FLT_MAX;
+			if (originZ > 0)
+				errors[i] = FLT_MAX;
+			if (originZ + ChunkSize < m_vpc - 1)
+				errors[ChunkSize * size + i] = FLT_MAX;
+		}
+
+		// Error of every split vertex, from the smallest triangles up. A vertex gets at least the error
+		// of the split vertices of its children, so a split triangle always has split parents.
+		for (int i = numTriangles - 1; i >= 0; i--) {
+			unsigned ax = coords[i * 4 + 0], ay = coords[i * 4 + 1];
+			unsigned bx = coords[i * 4 + 2], by = coords[i * 4 + 3];
+			unsigned mx = (ax + bx) >> 1, my = (ay + by) >> 1;
+			unsigned cx = mx + my - ay, cy = my + ax - mx;
+
+			float interpolated = (chunkHeights[ay * size + ax] + chunkHeights[by * size + bx]) / 2.0f;
+			unsigned middle = my * size + mx;
+			errors[middle] = std::max(errors[middle], std::abs(interpolated - chunkHeights[middle]));
+
+			if (unsigned(i) < numParentTriangles) {
+				unsigned left = ((ay + cy) >> 1) * size + ((ax + cx) >> 1);
+				unsigned right = ((by + cy) >> 1) * size + ((bx + cx) >> 1);
+				errors[middle] = std::max(errors[middle], std::max(errors[left], errors[right]));
+			}
+		}
+
+		// Split the two top level triangles as long as the error is too high. Each triangle is
+		// given by the two ends of its hypotenuse a and b and its right angle c.
+		vector<GLuint> &elements = chunkElements[chunk];
+		stack.insert(stack.end(), { 0, 0, ChunkSize, ChunkSize, ChunkSize, 0 });
+		stack.insert(stack.end(), { ChunkSize, ChunkSize, 0, 0, 0, ChunkSize });
+		while (!stack.empty()) {
+			unsigned cy = stack.back(); stack.pop_back();
+			unsigned cx = stack.back(); stack.pop_back();
+			unsigned by = stack.back(); stack.pop_back();
+			unsigned bx = stack.back(); stack.pop_back();
+			unsigned ay = stack.back(); stack.pop_back();
+			unsigned ax = stack.back(); stack.pop_back();
+			unsigned mx = (ax + bx) >> 1, my = (ay + by) >> 1;
+
+			if ((ax > cx ? ax - cx : cx - ax) + (ay > cy ? ay - cy : cy - ay) > 1 && errors[my * size + mx] > m_maxError) {
+				stack.insert(stack.end(), { (unsigned short)cx, (unsigned short)cy, (unsigned short)ax,
+					(unsigned short)ay, (unsigned short)mx, (unsigned short)my });
+				stack.insert(stack.end(), { (unsigned short)bx, (unsigned short)by, (unsigned short)cx,
+					(unsigned short)cy, (unsigned short)mx, (unsigned short)my });
+			}
+			else {
+				GLuint a = (originZ + ay) * m_vpr + originX + ax;
+				GLuint b = (originZ + by) * m_vpr + originX + bx;
+				GLuint c = (originZ + cy) * m_vpr + originX + cx;
+
+				// Same winding as the triangle strip, which is clockwise in grid coordinates
+				int cross = (int(bx) - int(ax)) * (int(cy) - int(ay)) - (int(by) - int(ay)) * (int(cx) - int(ax));
+				if (cross < 0)
+					elements.insert(elements.end(), { a, b, c });
+				else
+					elements.insert(elements.end(), { a, c, b });
+			}
+		}
+	});
+
+	// Put the chunks together
+	size_t count = 0;
+	for (const vector<GLuint> &e : chunkElements)
+		count += e.size();
+	target.clear();
+	target.reserve(count);
+	for (const vector<GLuint> &e : chunkElements)
+		target.insert(target.end(), e.begin(), e.end());
 }
 
-void Terrain::applyTexture(const char* samplerName, GLint texUnit)const{
+void Terrain::applyTexture(const char* samplerName, GLint texUnit){
 	checkGLError("Terrain::applyTexture(..) -> Error occured before this call.");
-	glUniform1i(glGetUniformLocation(m_programId, samplerName), texUnit);
+	setUniform(samplerName, texUnit);
 	checkGLError("Terrain::applyTexture(..)");
 }
 
-void Terrain::draw()const{
+void Terrain::draw(unsigned elementCount)const{
     glCullFace(GL_FRONT);
-    glDrawElements(GL_TRIANGLE_STRIP, m_elementsSize, GL_UNSIGNED_INT, nullptr);
+	if (m_vertexSource == VertexSource::HeightTexture) {
+		GLState::bindVertexArray(m_vaoId);
+		if (m_pulledIndexedDrawn)
+			glDrawElements(m_adaptiveDrawn ? GL_TRIANGLES : GL_TRIANGLE_STRIP, m_pulledElementCount, GL_UNSIGNED_INT, nullptr);
+		else
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, m_pulledVertexCount);
+	}
+	else
+		glDrawElements(m_adaptiveDrawn ? GL_TRIANGLES : GL_TRIANGLE_STRIP, elementCount, GL_UNSIGNED_INT, nullptr);
+}
+
+void Terrain::adoptElements(GLuint eboId, unsigned elementCount){
+	checkGLError("Terrain::adoptElements(..) -> Error occured before this call.");
+
+	// The element buffer binding is stored in the vertex array object
+	GLState::bindVertexArray(m_vaoId);
+	if (m_eboId != 0 && m_eboId != eboId)
+		GLState::deleteBuffers(1, &m_eboId);
+	m_eboId = eboId;
+	m_pulledElementCount = elementCount;
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_eboId);
+	checkGLError("Terrain::adoptElements(..)");
+}
+
+void Terrain::setVertexSource(VertexSource source){
+	checkGLError("Terrain::setVertexSource(..) -> Error occured before this call.");
+	m_vertexSource = source;
+	if (m_vertexSource == VertexSource::HeightTexture && m_vaoId == 0) {
+		glGenVertexArrays(1, &m_vaoId);
+		checkGLError("Terrain::setVertexSource(..) -> Create vertex array object");
+	}
 }
 
 void Terrain::setNoise(int seed, unsigned lC, float sF, float fF, float wD, float a){
@@ -302,30 +749,126 @@ void Terrain::setNoise(int seed, unsigned lC, float sF, float fF, float wD, floa
 void Terrain::setBrightness(float brightness){
 	checkGLError("Terrain::setBrightness(..) -> Error occured before this call.");
 	m_brightness = brightness;
-	static GLuint bightnessLoc = glGetUniformLocation(m_programId, "brightness");
-	glUniform1f(bightnessLoc, m_brightness);
+	setUniform("brightness", m_brightness);
 	checkGLError("Terrain::setBrightness(..)");
 }
 
+void Terrain::setNormalFormat(NormalFormat format){
+	checkGLError("Terrain::setNormalFormat(..) -> Error occured before this call.");
+	m_normalFormat = format;
+	selectVariant();
+	checkGLError("Terrain::setNormalFormat(..)");
+}
+
+unsigned Terrain::getNormalSize()const{
+	if (m_normalFormat == NormalFormat::Float)
+		return sizeof(vec3);
+	if (m_normalFormat == NormalFormat::Unorm8 || m_normalFormat == NormalFormat::Rgtc2)
+		return 2 * sizeof(GLubyte);
+	return 2 * sizeof(GLshort);
+}
+
+GLenum Terrain::getNormalType()const{
+	if (m_normalFormat == NormalFormat::Float)
+		return GL_FLOAT;
+	if (m_normalFormat == NormalFormat::Unorm8)
+		return GL_UNSIGNED_BYTE;
+	return GL_SHORT;
+}
+
 void Terrain::setSeamlessTexEnabled(bool enabled){
 	checkGLError("Terrain::setSeamlessTexEnabled(..) -> Error occured before this call.");
 	m_seamlessTexEnabled = enabled;
-	static GLuint seamlessEnabledLoc = glGetUniformLocation(m_programId, "seamlessTexEnabled");
-	glUniform1ui(seamlessEnabledLoc, m_seamlessTexEnabled);
+	selectVariant();
 	checkGLError("Terrain::setSeamlessTexEnabled(..)");
 }
 
-const vector<vec3>&
-Terrain::getNormalMap(unsigned detail){
-	if (detail == 0)
-		printCriticalError("Terrain::getNormalMap(..)", "Detail must be 1 or higher.");
-	else {
-		m_normalMapDetail = detail;
-		m_normalMapWidth = 256 * m_normalMapDetail;
-		m_normalMapHeight = 256 * m_normalMapDetail;
-		calculateNormalMap();
+void Terrain::setStoneDetailEnabled(bool enabled){
+	checkGLError("Terrain::setStoneDetailEnabled(..) -> Error occured before this call.");
+	m_stoneDetailEnabled = enabled;
+	selectVariant();
+	checkGLError("Terrain::setStoneDetailEnabled(..)");
+}
+
+void Terrain::selectVariant(){
+	// The decoding in the fragment shader: 0 = xyz, 1 = signed xz, 2 = unsigned xz, 3 = octahedral
+	unsigned encoding = 0;
+	if (m_normalFormat == NormalFormat::Snorm16 || m_normalFormat == NormalFormat::Rgtc2)
+		encoding = 1;
+	else if (m_normalFormat == NormalFormat::Unorm8)
+		encoding = 2;
+	else if (m_normalFormat == NormalFormat::Octahedral)
+		encoding = 3;
+	unsigned variant = (m_seamlessTexEnabled ? 1 : 0) | (m_stoneDetailEnabled ? 2 : 0) | encoding << 2;
+
+	if (!m_variants[variant]) {
+		checkGLError("Terrain::selectVariant() -> Error occured before this call.");
+		vector<string> defines = { "NORMAL_ENCODING " + to_string(encoding) };
+		if (m_seamlessTexEnabled)
+			defines.push_back("SEAMLESS_DETAIL");
+		if (m_stoneDetailEnabled)
+			defines.push_back("STONE_DETAIL");
+		string cache = m_cache;
+		if (!cache.empty())
+			cache.insert(min(cache.rfind('.'), cache.size()), "." + to_string(variant));
+		Shader *shader = new Shader(m_vsh, m_fsh, cache, defines);
+
+		// The vertex buffers are set up with the attribute locations of the first variant. The variants
+		// share the vertex shader, but the linker is free to choose other locations.
+		if (Shader *first = m_variants[m_variant])
+			for (const char *attrib : { "texCoord", "height" })
+				if (glGetAttribLocation(shader->getId(), attrib) != glGetAttribLocation(first->getId(), attrib))
+					printError("Terrain::selectVariant()", "Attribute '" + string(attrib) + "' has another location in variant " +
+						to_string(variant) + ". The terrain may be drawn wrong.");
+		m_variants[variant] = shader;
+		checkGLError("Terrain::selectVariant() -> Compile variant " + to_string(variant));
 	}
-	return *m_normalMap;
+	else if (variant == m_variant)
+		return;
+
+	// Set all uniforms for the new variant, the camera sets its own ones when it notices the change
+	m_variant = variant;
+	m_variants[m_variant]->use();
+	for (const auto &uniform : m_uniforms)
+		uploadUniform(uniform.first, uniform.second);
+	checkGLError("Terrain::selectVariant()");
+}
+
+void Terrain::setUniform(const string &name, GLfloat x){
+	Uniform &u = m_uniforms[name];
+	u = { false, 1, { x, 0.0f }, { 0, 0 } };
+	uploadUniform(name, u);
+}
+
+void Terrain::setUniform(const string &name, GLfloat x, GLfloat y){
+	Uniform &u = m_uniforms[name];
+	u = { false, 2, { x, y }, { 0, 0 } };
+	uploadUniform(name, u);
+}
+
+void Terrain::setUniform(const string &name, GLint x){
+	Uniform &u = m_uniforms[name];
+	u = { true, 1, { 0.0f, 0.0f }, { x, 0 } };
+	uploadUniform(name, u);
+}
+
+void Terrain::setUniform(const string &name, GLint x, GLint y){
+	Uniform &u = m_uniforms[name];
+	u = { true, 2, { 0.0f, 0.0f }, { x, y } };
+	uploadUniform(name, u);
+}
+
+void Terrain::uploadUniform(const string &name, const Uniform &uniform)const{
+	// Uniforms that a variant does not use, e.g. a sampler that is compiled out, have the location -1 and are ignored
+	GLint location = GLState::getUniformLocation(getProgramId(), name);
+	if (uniform.integer && uniform.count == 1)
+		glUniform1i(location, uniform.i[0]);
+	else if (uniform.integer)
+		glUniform2i(location, uniform.i[0], uniform.i[1]);
+	else if (uniform.count == 1)
+		glUniform1f(location, uniform.f[0]);
+	else
+		glUniform2f(location, uniform.f[0], uniform.f[1]);
 }
 
 const vector<vec3>&
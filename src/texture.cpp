@@ -1,6 +1,17 @@
 #include "texture.h"
 
-Texture::Texture(const char* file, GLint wrapper, GLint filter, GLuint texUnit) : m_unit(texUnit){
+Texture::Texture(const char* file, GLint wrapper, GLint filter, GLuint texUnit)
+	: m_texWidth(0), m_texHeight(0), m_unit(texUnit), id(0)
+{
+	// Containers already hold their mipmaps
+	string path(file);
+	if (path.size() > 4 && path.substr(path.size() - 4) == ".ktx") {
+		TextureImage image;
+		if (decode(path, image))
+			upload(image, wrapper, filter);
+		return;
+	}
+
 	// Load bmp image
 	SDL_Surface* texture = SDL_LoadBMP(file);
 	
@@ -12,7 +23,7 @@ Texture::Texture(const char* file, GLint wrapper, GLint filter, GLuint texUnit)
 		glGenTextures(1, &id);
 
 		// Bind texture
-		use();
+		bind();
 
 		// Texture parameter
 		if (wrapper != GL_NONE){
@@ -65,12 +76,12 @@ Texture::Texture(const char* file, GLint wrapper, GLint filter, GLuint texUnit)
 	SDL_FreeSurface(texture);
 }
 
-Texture::Texture(const void* data, unsigned tW, unsigned tH, GLenum format, GLint wrapper, GLint filter, GLuint texUnit)
+Texture::Texture(const void* data, unsigned tW, unsigned tH, GLenum format, GLint wrapper, GLint filter, GLuint texUnit, GLenum type)
 	: m_texWidth(tW), m_texHeight(tH), m_unit(texUnit) 
 {
 	if (tW == 0 || tH == 0)
 		printCriticalError("Texture(..) 2", "Texture width and / or height must not be 0.");
-	else if (data){
+	else {
 		// Clean error buffer
 		checkGLError("Texture(..) 1 -> Error occured before this call.");
 
@@ -78,7 +89,7 @@ Texture::Texture(const void* data, unsigned tW, unsigned tH, GLenum format, GLin
 		glGenTextures(1, &id);
 
 		// Bind texture
-		use();
+		bind();
 
 		// Texture parameter
 		if (wrapper != GL_NONE){
@@ -106,13 +117,30 @@ Texture::Texture(const void* data, unsigned tW, unsigned tH, GLenum format, GLin
 			mipmapping = true;
 		}
 
+		// Rows of single and two channel textures are not always aligned to 4 bytes
+		if (format == GL_RED || format == GL_RG)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
 		// Upload texture
 		if(format == GL_RGB)
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, m_texWidth, m_texHeight, 0, format, GL_FLOAT, data);
+		else if (format == GL_RGBA && type == GL_UNSIGNED_BYTE)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_texWidth, m_texHeight, 0, format, type, data);
 		else if (format == GL_RGBA)
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, m_texWidth, m_texHeight, 0, format, GL_FLOAT, data);
+		else if (format == GL_RED && type == GL_UNSIGNED_SHORT)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, m_texWidth, m_texHeight, 0, format, type, data);
+		else if (format == GL_RED && type == GL_UNSIGNED_BYTE)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m_texWidth, m_texHeight, 0, format, type, data);
+		else if (format == GL_RED)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_texWidth, m_texHeight, 0, format, GL_FLOAT, data);
+		else if (format == GL_RG && type == GL_SHORT)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16_SNORM, m_texWidth, m_texHeight, 0, format, type, data);
+		else if (format == GL_RG && type == GL_UNSIGNED_BYTE)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, m_texWidth, m_texHeight, 0, format, type, data);
 		else
 			printError("Texture(..) 2", "Given format is not supported.");
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 		checkGLError("Texture(..) 2 -> Upload texture data");
 
 		// Generate mipmap textures
@@ -124,10 +152,63 @@ Texture::Texture(const void* data, unsigned tW, unsigned tH, GLenum format, GLin
 		//Cleanup texture binds.
 		unbind();
 	}
-	else
-		printError("Texture(..) 2", "Given texture data is invalid");
 }
 
+Texture::Texture(const vector<const void*> &levels, unsigned tW, unsigned tH, GLenum internalFormat,
+	GLint wrapper, GLint filter, GLuint texUnit)
+	: m_texWidth(tW), m_texHeight(tH), m_unit(texUnit)
+{
+	if (tW == 0 || tH == 0 || levels.empty())
+		printCriticalError("Texture(..) 3", "Texture width and / or height and the number of levels must not be 0.");
+	else {
+		// Clean error buffer
+		checkGLError("Texture(..) 3 -> Error occured before this call.");
+
+		// Generate tex id
+		glGenTextures(1, &id);
+
+		// Bind texture
+		bind();
+
+		// Texture parameter
+		if (wrapper != GL_NONE) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapper);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapper);
+			checkGLError("Texture(..) 3 -> Texture parameter for GL_TEXTURE_WRAP_(S / T)");
+		}
+		if (filter != GL_NONE) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+			checkGLError("Texture(..) 3 -> Texture parameter for GL_TEXTURE_MIN_FILTER");
+		}
+		if (filter == GL_NEAREST || filter == GL_LINEAR) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+			checkGLError("Texture(..) 3 -> Texture parameter for GL_TEXTURE_MAG_FILTER");
+		}
+
+		// Only the given levels exist
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(levels.size()) - 1);
+		checkGLError("Texture(..) 3 -> Texture parameter for mipmaps");
+
+		// Upload the levels. Levels without data are allocated through glTexImage2D.
+		for (unsigned level = 0; level < levels.size(); level++) {
+			unsigned w = std::max(tW >> level, 1u);
+			unsigned h = std::max(tH >> level, 1u);
+			if (levels[level])
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, w, h, 0,
+					compressedSize(internalFormat, w, h), levels[level]);
+			else
+				glTexImage2D(GL_TEXTURE_2D, level, internalFormat, w, h, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
+			checkGLError("Texture(..) 3 -> Upload compressed texture data");
+		}
+
+		//Cleanup texture binds.
+		unbind();
+	}
+}
+
+Texture::Texture(GLuint texUnit) : m_texWidth(0), m_texHeight(0), m_unit(texUnit), id(0) {}
+
 void Texture::sub(const void* data, GLenum format, GLenum type, unsigned texWidth, unsigned texHeight){
 	if (texWidth == 0 || texHeight == 0)
 		printError("Texture::sub(..)", "Texture width and / or height must not be 0. No texture data uploaded");
@@ -136,7 +217,7 @@ void Texture::sub(const void* data, GLenum format, GLenum type, unsigned texWidt
 		checkGLError("Texture(..) 1 -> Error occured before this call.");
 
 		// Bind texture
-		use();
+		bind();
 
 		// If size is the same ..
 		if (texWidth == m_texWidth && texHeight == m_texHeight) {
@@ -160,12 +241,404 @@ void Texture::sub(const void* data, GLenum format, GLenum type, unsigned texWidt
 	}
 }
 
+void Texture::subRows(const void* data, GLenum format, GLenum type, unsigned y, unsigned rows){
+	if (y + rows > m_texHeight)
+		printError("Texture::subRows(..)", "Rows exceed the texture height. No texture data uploaded");
+	else {
+		// Clean error buffer
+		checkGLError("Texture::subRows(..) -> Error occured before this call.");
+
+		// Bind texture and overwrite the rows
+		bind();
+		if (format == GL_RED || format == GL_RG)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, m_texWidth, rows, format, type, data);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		checkGLError("Texture::subRows(..) -> glTexSubImage2D()");
+
+		//Cleanup texture binds.
+		unbind();
+	}
+}
+
+void Texture::subRect(const void* data, GLenum format, GLenum type, unsigned x, unsigned y, unsigned width, unsigned height){
+	if (x + width > m_texWidth || y + height > m_texHeight)
+		printError("Texture::subRect(..)", "Rectangle exceeds the texture. No texture data uploaded");
+	else {
+		// Clean error buffer
+		checkGLError("Texture::subRect(..) -> Error occured before this call.");
+
+		// Bind texture and overwrite the rectangle
+		bind();
+		if (format == GL_RED || format == GL_RG)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, type, data);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		checkGLError("Texture::subRect(..) -> glTexSubImage2D()");
+
+		//Cleanup texture binds.
+		unbind();
+	}
+}
+
+void Texture::subCompressedRows(const void* data, GLenum internalFormat, unsigned y, unsigned rows){
+	if (y + rows > m_texHeight || y % 4 != 0 || (rows % 4 != 0 && y + rows != m_texHeight))
+		printError("Texture::subCompressedRows(..)", "Rows exceed the texture height or are not aligned to blocks. No texture data uploaded");
+	else {
+		// Clean error buffer
+		checkGLError("Texture::subCompressedRows(..) -> Error occured before this call.");
+
+		// Bind texture and overwrite the rows
+		bind();
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, m_texWidth, rows, internalFormat,
+			compressedSize(internalFormat, m_texWidth, rows), data);
+		checkGLError("Texture::subCompressedRows(..) -> glCompressedTexSubImage2D()");
+
+		//Cleanup texture binds.
+		unbind();
+	}
+}
+
+GLsizei Texture::compressedSize(GLenum internalFormat, unsigned width, unsigned height){
+	// 4x4 blocks of 8 bytes per channel
+	GLsizei blocks = ((width + 3) / 4) * ((height + 3) / 4);
+	if (internalFormat == GL_COMPRESSED_RED_RGTC1 || internalFormat == GL_COMPRESSED_SIGNED_RED_RGTC1)
+		return blocks * 8;
+	if (internalFormat == GL_COMPRESSED_RG_RGTC2 || internalFormat == GL_COMPRESSED_SIGNED_RG_RGTC2)
+		return blocks * 16;
+	if (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+		return blocks * 8;
+	printError("Texture::compressedSize(..)", "Given compressed format is not supported.");
+	return 0;
+}
+
+bool Texture::decode(const string &file, TextureImage &image){
+	image = TextureImage();
+
+	// Bmp images are decoded to tightly packed RGB rows
+	if (file.size() < 4 || file.substr(file.size() - 4) != ".ktx") {
+		SDL_Surface *loaded = SDL_LoadBMP(file.c_str());
+		SDL_Surface *surface = loaded ? SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGB24, 0) : nullptr;
+		SDL_FreeSurface(loaded);
+		if (!surface) {
+			printError("Texture::decode(..)", "Failed to load image -> " + string(SDL_GetError()));
+			return false;
+		}
+		image.width = surface->w;
+		image.height = surface->h;
+		image.format = GL_RGB;
+		image.type = GL_UNSIGNED_BYTE;
+		image.internalFormat = GL_RGB8;
+		image.alignment = 1;
+		image.pixels.resize(image.width * image.height * 3);
+		for (unsigned y = 0; y < image.height; y++)
+			memcpy(&image.pixels[y * image.width * 3], (const GLubyte*)surface->pixels + y * surface->pitch, image.width * 3);
+		SDL_FreeSurface(surface);
+		image.levels.push_back(image.pixels.data());
+		image.sizes.push_back(GLuint(image.pixels.size()));
+		return true;
+	}
+
+	image.file = make_shared<MappedFile>(file);
+	if (!image.file->isOpen()) {
+		printError("Texture::decode(..)", "Failed to load container -> " + file);
+		return false;
+	}
+
+	// KTX 1.1: identifier, 13 values of 32 bit, key value data, then the levels
+	static const GLubyte identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const GLubyte *data = image.file->getData();
+	size_t size = image.file->getSize();
+	GLuint header[13];
+	if (size < sizeof(identifier) + sizeof(header) || memcmp(data, identifier, sizeof(identifier)) != 0) {
+		printError("Texture::decode(..)", file + " is no KTX 1.1 container.");
+		return false;
+	}
+	memcpy(header, data + sizeof(identifier), sizeof(header));
+	image.type = header[1];
+	image.format = header[3];
+	image.internalFormat = header[4];
+	image.width = header[6];
+	image.height = header[7];
+	if (header[0] != 0x04030201 || header[8] > 1 || header[9] > 0 || header[10] != 1 || image.width == 0 || image.height == 0) {
+		printError("Texture::decode(..)", file + " is no little endian 2D container.");
+		return false;
+	}
+
+	// The driver can not upload S3TC levels, so take the '.bmp' file the container was made of
+	if (image.internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT && !GLEW_EXT_texture_compression_s3tc) {
+		string bmp = file.substr(0, file.rfind('.')) + ".bmp";
+		printError("Texture::decode(..)", file + " is S3TC compressed, which is not supported by the driver. Loading " + bmp + " instead.");
+		return decode(bmp, image);
+	}
+
+	// Find the levels. The rows of uncompressed levels are aligned to 4 bytes.
+	unsigned levels = std::max(header[11], 1u);
+	size_t offset = sizeof(identifier) + sizeof(header) + header[12];
+	for (unsigned level = 0; level < levels; level++) {
+		GLuint imageSize = 0;
+		if (offset + sizeof(imageSize) <= size)
+			memcpy(&imageSize, data + offset, sizeof(imageSize));
+		offset += sizeof(imageSize);
+		if (offset + imageSize > size) {
+			printError("Texture::decode(..)", file + " is truncated.");
+			return false;
+		}
+		image.levels.push_back(data + offset);
+		image.sizes.push_back(imageSize);
+		offset += (imageSize + 3) & ~3u;
+	}
+
+	// Touch every page, so that the file is read here and not during the upload
+	volatile GLubyte sum = 0;
+	for (size_t i = 0; i < size; i += 4096)
+		sum += data[i];
+	return true;
+}
+
+Texture::Texture(const TextureImage &image, GLint wrapper, GLint filter, GLuint texUnit)
+	: m_texWidth(0), m_texHeight(0), m_unit(texUnit), id(0)
+{
+	upload(image, wrapper, filter);
+}
+
+void Texture::upload(const TextureImage &image, GLint wrapper, GLint filter){
+	if (image.levels.empty()) {
+		printError("Texture::upload(..)", "Given image is empty. No texture data uploaded");
+		return;
+	}
+	bool compressed = image.type == GL_NONE;
+	if (image.internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT && !GLEW_EXT_texture_compression_s3tc) {
+		printError("Texture::upload(..)", "Image is S3TC compressed, which is not supported by the driver.");
+		return;
+	}
+
+	// Clean error buffer
+	checkGLError("Texture::upload(..) -> Error occured before this call.");
+
+	// Generate texture id and bind it
+	glGenTextures(1, &id);
+	bind();
+	m_texWidth = image.width;
+	m_texHeight = image.height;
+
+	// Texture parameter
+	if (wrapper != GL_NONE) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapper);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapper);
+	}
+	if (filter != GL_NONE)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	if (filter == GL_NEAREST || filter == GL_LINEAR)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+	// Mipmapping with the levels of the image. Only a single uncompressed level gets generated mipmaps.
+	bool mipmapping = filter == GL_LINEAR_MIPMAP_LINEAR || filter == GL_LINEAR_MIPMAP_NEAREST ||
+		filter == GL_NEAREST_MIPMAP_LINEAR || filter == GL_NEAREST_MIPMAP_NEAREST;
+	unsigned levels = mipmapping ? unsigned(image.levels.size()) : 1;
+	bool generate = mipmapping && levels == 1 && !compressed;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, generate ? 4 : levels - 1);
+	checkGLError("Texture::upload(..) -> Texture parameter");
+
+	// Upload level by level
+	glPixelStorei(GL_UNPACK_ALIGNMENT, image.alignment);
+	for (unsigned level = 0; level < levels; level++) {
+		unsigned w = std::max(image.width >> level, 1u);
+		unsigned h = std::max(image.height >> level, 1u);
+		if (compressed)
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, image.internalFormat, w, h, 0, image.sizes[level], image.levels[level]);
+		else
+			glTexImage2D(GL_TEXTURE_2D, level, image.internalFormat, w, h, 0, image.format, image.type, image.levels[level]);
+		checkGLError("Texture::upload(..) -> Upload level");
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	if (generate) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+		checkGLError("Texture::upload(..) -> Generate mipmaps");
+	}
+
+	//Cleanup texture binds.
+	unbind();
+}
+
+bool Texture::convertToContainer(const char* bmp, const char* ktx, bool compress){
+	// Load bmp image as RGB
+	SDL_Surface *loaded = SDL_LoadBMP(bmp);
+	if (!loaded) {
+		printError("Texture::convertToContainer(..)", "Failed to load image -> " + string(SDL_GetError()));
+		return false;
+	}
+	SDL_Surface *surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGB24, 0);
+	SDL_FreeSurface(loaded);
+	if (!surface) {
+		printError("Texture::convertToContainer(..)", "Failed to convert image -> " + string(SDL_GetError()));
+		return false;
+	}
+
+	// Rows in the same order as the bmp upload, without the pitch of the surface
+	unsigned width = surface->w, height = surface->h;
+	vector<GLubyte> pixels(width * height * 3);
+	for (unsigned y = 0; y < height; y++)
+		memcpy(&pixels[y * width * 3], (const GLubyte*)surface->pixels + y * surface->pitch, width * 3);
+	SDL_FreeSurface(surface);
+
+	// All levels down to 1x1
+	unsigned levels = 1;
+	while ((std::max(width, height) >> levels) > 0)
+		levels++;
+
+	ofstream file(ktx, ios::binary | ios::trunc);
+	if (!file) {
+		printError("Texture::convertToContainer(..)", string("Failed to write container -> ") + ktx);
+		return false;
+	}
+	static const GLubyte identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	GLuint header[13] = { 0x04030201, compress ? 0u : GLuint(GL_UNSIGNED_BYTE), 1, compress ? 0u : GLuint(GL_RGB),
+		compress ? GLuint(GL_COMPRESSED_RGB_S3TC_DXT1_EXT) : GLuint(GL_RGB8), GL_RGB, width, height, 0, 0, 1, levels, 0 };
+	file.write((const char*)identifier, sizeof(identifier));
+	file.write((const char*)header, sizeof(header));
+
+	vector<GLubyte> image, next;
+	for (unsigned level = 0; level < levels; level++) {
+		if (compress) {
+			// Blocks of 4x4 pixels, the last row and column are repeated for incomplete blocks
+			unsigned blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+			image.resize(blocksX * blocksY * 8);
+			GLubyte rgb[48];
+			for (unsigned by = 0; by < blocksY; by++) {
+				for (unsigned bx = 0; bx < blocksX; bx++) {
+					for (unsigned i = 0; i < 16; i++) {
+						unsigned x = std::min(bx * 4 + i % 4, width - 1);
+						unsigned y = std::min(by * 4 + i / 4, height - 1);
+						memcpy(&rgb[i * 3], &pixels[(y * width + x) * 3], 3);
+					}
+					compressBlockDXT1(rgb, &image[(by * blocksX + bx) * 8]);
+				}
+			}
+		}
+		else {
+			// Rows aligned to 4 bytes
+			unsigned rowSize = (width * 3 + 3) & ~3u;
+			image.assign(rowSize * height, 0);
+			for (unsigned y = 0; y < height; y++)
+				memcpy(&image[y * rowSize], &pixels[y * width * 3], width * 3);
+		}
+		GLuint imageSize = GLuint(image.size());
+		file.write((const char*)&imageSize, sizeof(imageSize));
+		file.write((const char*)image.data(), imageSize);
+
+		// Next level as the mean of 2x2 pixels
+		unsigned nextWidth = std::max(width / 2, 1u), nextHeight = std::max(height / 2, 1u);
+		next.resize(nextWidth * nextHeight * 3);
+		for (unsigned y = 0; y < nextHeight; y++) {
+			for (unsigned x = 0; x < nextWidth; x++) {
+				unsigned x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+				unsigned y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+				for (unsigned c = 0; c < 3; c++)
+					next[(y * nextWidth + x) * 3 + c] = GLubyte((pixels[(y0 * width + x0) * 3 + c] +
+						pixels[(y0 * width + x1) * 3 + c] + pixels[(y1 * width + x0) * 3 + c] +
+						pixels[(y1 * width + x1) * 3 + c] + 2) / 4);
+			}
+		}
+		pixels.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+	return bool(file);
+}
+
+void Texture::compressBlockDXT1(const GLubyte *rgb, GLubyte *block){
+	// Bounding box and mean of the colors
+	int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 }, mean[3] = { 0, 0, 0 };
+	for (unsigned i = 0; i < 16; i++) {
+		for (unsigned c = 0; c < 3; c++) {
+			low[c] = std::min(low[c], int(rgb[i * 3 + c]));
+			high[c] = std::max(high[c], int(rgb[i * 3 + c]));
+			mean[c] += rgb[i * 3 + c];
+		}
+	}
+
+	// Choose the diagonal of the box along which the colors spread, relative to the widest channel
+	unsigned widest = 0;
+	for (unsigned c = 1; c < 3; c++)
+		if (high[c] - low[c] > high[widest] - low[widest])
+			widest = c;
+	int covariance[3] = { 0, 0, 0 };
+	for (unsigned i = 0; i < 16; i++) {
+		int w = rgb[i * 3 + widest] * 16 - mean[widest];
+		for (unsigned c = 0; c < 3; c++)
+			covariance[c] += (rgb[i * 3 + c] * 16 - mean[c]) * w;
+	}
+	for (unsigned c = 0; c < 3; c++)
+		if (covariance[c] < 0)
+			std::swap(low[c], high[c]);
+
+	// End points in RGB565. With color0 > color1 the block has 4 colors.
+	auto pack = [](const int *c) { return GLushort(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3)); };
+	GLushort color0 = pack(high), color1 = pack(low);
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	// Palette as it is decoded: color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1
+	int palette[4][3];
+	for (unsigned p = 0; p < 2; p++) {
+		GLushort c = p == 0 ? color0 : color1;
+		palette[p][0] = ((c >> 11) & 31) * 255 / 31;
+		palette[p][1] = ((c >> 5) & 63) * 255 / 63;
+		palette[p][2] = (c & 31) * 255 / 31;
+	}
+	for (unsigned c = 0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	// 2 bit index of the nearest palette color per pixel. Equal end points only use color0.
+	GLuint indices = 0;
+	if (color0 != color1) {
+		for (unsigned i = 0; i < 16; i++) {
+			unsigned best = 0;
+			int bestDistance = INT_MAX;
+			for (unsigned p = 0; p < 4; p++) {
+				int dr = rgb[i * 3] - palette[p][0], dg = rgb[i * 3 + 1] - palette[p][1], db = rgb[i * 3 + 2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << (2 * i);
+		}
+	}
+
+	block[0] = GLubyte(color0);
+	block[1] = GLubyte(color0 >> 8);
+	block[2] = GLubyte(color1);
+	block[3] = GLubyte(color1 >> 8);
+	for (unsigned i = 0; i < 4; i++)
+		block[4 + i] = GLubyte(indices >> (8 * i));
+}
+
+string Texture::preferContainer(const string &bmp){
+	string ktx = bmp.substr(0, bmp.rfind('.')) + ".ktx";
+	return ifstream(ktx) ? ktx : bmp;
+}
+
+void Texture::swap(Texture &other) {
+	std::swap(id, other.id);
+	std::swap(m_texWidth, other.m_texWidth);
+	std::swap(m_texHeight, other.m_texHeight);
+}
+
 void Texture::use() {
-	glActiveTexture(GL_TEXTURE0 + m_unit);
-	glBindTexture(GL_TEXTURE_2D, id);
+	GLState::bindTexture(m_unit, id);
+}
+
+void Texture::bind() {
+	GLState::selectTexture(m_unit, id);
 }
 
 void Texture::unbind() {
-	glActiveTexture(GL_TEXTURE0 + m_unit);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLState::bindTexture(m_unit, 0);
 }
@@ -5,7 +5,7 @@
 */
 const Window* _window = nullptr;
 
-Window::Window(int width, int height) : m_fps(0), m_width(width), m_height(height),
+Window::Window(int width, int height) : m_width(width), m_height(height),
 	m_aspect(float(width) / float(height)), m_mouseModeReleased(false)
 {
 	if (width <= 0 || height <= 0)
@@ -27,6 +27,11 @@ void Window::open(Style s){
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
 
+	// Debug builds ask for a debug context, which reports the errors through the debug output
+#ifndef NDEBUG
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+#endif
+
 	// Enable antialising for polygons | Note: currently disabled because of performance
 	//SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
 	//SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 8);
@@ -63,6 +68,10 @@ void Window::open(Style s){
 	if (!GLEW_VERSION_3_0)
 		printCriticalError("Window::open(..)", "GLEW Error: Graphics card does not support OpenGL 3.0");
 
+	// When the driver reports the errors itself, glGetError does not need to be polled anymore
+	if (enableGLDebugOutput())
+		setGLErrorPolling(false);
+
 	// Limit frames per second to 60
 	SDL_GL_SetSwapInterval(1);
 }
@@ -71,6 +80,7 @@ bool Window::update(){
 	// Create SDL Event variable
 	SDL_Event evt;
 	m_windowResized = false;
+	m_mouseEvents.clear();
 
 	// Getting SDL events
 	while (SDL_PollEvent(&evt)){
@@ -103,6 +113,8 @@ bool Window::update(){
 				SDL_SetRelativeMouseMode(SDL_TRUE);
 			m_mouseModeReleased = false;
 		}
+		else if (evt.type == SDL_MOUSEMOTION || evt.type == SDL_MOUSEBUTTONDOWN || evt.type == SDL_MOUSEBUTTONUP)
+			m_mouseEvents.push_back(evt);
 	}
 
 	// Swap back buffer with front buffer and draw context
@@ -117,17 +129,27 @@ void Window::close(){
 	SDL_Quit();
 }
 
-void Window::calculateFPS(){
-	// Calculate fps using the standard library's "steady clock" for time measurement
-	static auto t0 = chrono::steady_clock::now();
-	static int frameCount = 0;
-	if ((chrono::steady_clock::now() - t0).count() > chrono::steady_clock::period::den){
-		m_fps = frameCount;
-		cout << "FPS: " << m_fps << endl;
-		t0 = chrono::steady_clock::now();
-		frameCount = 0;
-	}
-	frameCount++;
+SDL_GLContext Window::createSharedContext(){
+	// The new context shares its objects with the context that is current while creating it
+	SDL_GL_MakeCurrent(m_wnd, m_glc);
+	SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+	SDL_GLContext context = SDL_GL_CreateContext(m_wnd);
+	SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+
+	// SDL makes the new context current, so switch back to the main context
+	SDL_GL_MakeCurrent(m_wnd, m_glc);
+
+	if (!context)
+		printError("Window::createSharedContext()", "SDL Error: " + string(SDL_GetError()));
+	return context;
+}
+
+void Window::makeCurrent(SDL_GLContext context)const{
+	if (SDL_GL_MakeCurrent(context ? m_wnd : nullptr, context) != 0)
+		printError("Window::makeCurrent(..)", "SDL Error: " + string(SDL_GetError()));
+
+	// The bindings of the former context are not valid for the new one
+	GLState::invalidate();
 }
 
 const Window* getMainWindow(){
@@ -0,0 +1,122 @@
+#include "workerpool.h"
+
+WorkerPool::WorkerPool() : m_stop(false) {
+	unsigned cores = thread::hardware_concurrency();
+	for (unsigned i = 1; i < cores; i++)
+		m_threads.push_back(thread(&WorkerPool::loop, this));
+}
+
+WorkerPool::~WorkerPool(){
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (thread &t : m_threads)
+		t.join();
+}
+
+WorkerPool& WorkerPool::instance(){
+	static WorkerPool pool;
+	return pool;
+}
+
+void WorkerPool::run(unsigned count, const function<void(unsigned)> &work){
+	if (count == 0)
+		return;
+
+	WorkerPool &pool = instance();
+
+	// Not worth waking up the pool for a single index or without any threads
+	if (count == 1 || pool.m_threads.empty()) {
+		for (unsigned i = 0; i < count; i++)
+			work(i);
+		return;
+	}
+
+	shared_ptr<Batch> batch = make_shared<Batch>();
+	batch->work = &work;
+	batch->count = count;
+	batch->next = 0;
+	batch->done = 0;
+	{
+		lock_guard<mutex> lock(pool.m_mutex);
+		pool.m_batches.push_back(batch);
+	}
+	pool.m_wake.notify_all();
+
+	// Work on the own batch, then wait for the indices that other threads took
+	WorkerPool::work(*batch);
+	{
+		unique_lock<mutex> lock(batch->finishedMutex);
+		batch->finished.wait(lock, [&batch] { return batch->done.load() == batch->count; });
+	}
+
+	lock_guard<mutex> lock(pool.m_mutex);
+	pool.m_batches.erase(find(pool.m_batches.begin(), pool.m_batches.end(), batch));
+}
+
+void WorkerPool::post(function<void()> task){
+	WorkerPool &pool = instance();
+	if (pool.m_threads.empty()) {
+		task();
+		return;
+	}
+
+	// A batch of a single index, which owns its work, as nobody waits for it
+	shared_ptr<Batch> batch = make_shared<Batch>();
+	batch->posted = [task](unsigned) { task(); };
+	batch->work = &batch->posted;
+	batch->count = 1;
+	batch->next = 0;
+	batch->done = 0;
+	{
+		lock_guard<mutex> lock(pool.m_mutex);
+		pool.m_batches.push_back(batch);
+	}
+	pool.m_wake.notify_one();
+}
+
+void WorkerPool::work(Batch &batch){
+	unsigned i;
+	while ((i = batch.next++) < batch.count) {
+		(*batch.work)(i);
+
+		// The last index wakes up the caller
+		if (++batch.done == batch.count) {
+			lock_guard<mutex> lock(batch.finishedMutex);
+			batch.finished.notify_all();
+		}
+	}
+}
+
+void WorkerPool::loop(){
+	unique_lock<mutex> lock(m_mutex);
+	while (true) {
+		shared_ptr<Batch> batch;
+		m_wake.wait(lock, [this, &batch] {
+			if (m_stop)
+				return true;
+			for (auto &b : m_batches)
+				if (b->next.load() < b->count) {
+					batch = b;
+					return true;
+				}
+			return false;
+		});
+		if (m_stop)
+			return;
+
+		// Work outside of the lock, so other threads can take the same or a newer batch
+		lock.unlock();
+		work(*batch);
+		lock.lock();
+
+		// Nobody waits for a posted batch, so it is removed here
+		if (batch->work == &batch->posted) {
+			auto posted = find(m_batches.begin(), m_batches.end(), batch);
+			if (posted != m_batches.end())
+				m_batches.erase(posted);
+		}
+	}
+}